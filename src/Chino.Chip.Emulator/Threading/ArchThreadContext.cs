@@ -8,5 +8,6 @@ namespace Chino.Chip.Emulator.Threading
     public class ArchThreadContext : ThreadContext
     {
         public UIntPtr NativeHandle;
+        public UIntPtr GCThread;
     }
 }
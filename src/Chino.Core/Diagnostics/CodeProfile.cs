@@ -0,0 +1,17 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Runtime.CompilerServices;
+using System.Text;
+
+namespace Chino.Diagnostics
+{
+    public class CodeProfile
+    {
+        /// <summary>
+        /// Writes the method entry counts to the kernel debug output, false if the kernel was built without CHINO_PROFILE.
+        /// Natsu.Compiler reads the log back from src/Native/natsu.profile to lay out the hot methods.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern bool Dump();
+    }
+}
@@ -12,5 +12,70 @@ namespace Chino.Memory
 
         [MethodImpl(MethodImplOptions.InternalCall)]
         public static extern int GetFreeMemorySize();
+
+        /// <summary>
+        /// Lowest free memory size since startup.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern int GetMinimumEverFreeMemorySize();
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern int GetLargestFreeBlockSize();
+
+        /// <summary>
+        /// Share of the free memory that is not in the largest free block.
+        /// </summary>
+        public static float GetFragmentation()
+        {
+            var freeMemory = GetFreeMemorySize();
+            return freeMemory == 0 ? 0 : 1 - (float)GetLargestFreeBlockSize() / freeMemory;
+        }
+
+        /// <summary>
+        /// Gets the objects allocated since startup of the type at the index, false past the last type.
+        /// The type is identified by its vtable address, which the kernel symbol map resolves.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern bool GetAllocationStatistics(int index, out IntPtr type, out int count, out long bytes);
+
+        /// <summary>
+        /// Bytes allocated between two allocation samples, 0 disables sampling.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern int GetAllocationSampleInterval();
+
+        /// <summary>
+        /// Sets the allocation sample interval and discards the samples taken.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern void SetAllocationSampleInterval(int bytes);
+
+        /// <summary>
+        /// Gets the sample at the index, oldest first, false past the last sample.
+        /// The call site is a return address into the allocating code.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern bool GetAllocationSample(int index, out IntPtr callSite, out IntPtr type, out int size);
+
+        /// <summary>
+        /// Maximum pause of an incremental GC step in microseconds, 0 makes full collections stop the world.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern int GetGCMaxPause();
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern void SetGCMaxPause(int microseconds);
+
+        /// <summary>
+        /// Longest GC pause observed in microseconds.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern int GetGCLongestPause();
+
+        /// <summary>
+        /// Runs an incremental marking step if a collection is in progress.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern void StepGC();
     }
 }
@@ -5,6 +5,7 @@ using System.Diagnostics.CodeAnalysis;
 using System.Threading;
 using Chino.Chip;
 using Chino.Collections;
+using Chino.Memory;
 using Chino.Objects;
 using ThreadState = System.Diagnostics.ThreadState;
 
@@ -252,6 +253,7 @@ namespace Chino.Threading
         {
             while (true)
             {
+                MemoryManager.StepGC();
                 //DelayCurrentThread(TimeSlice);
             }
         }
@@ -43,6 +43,19 @@ void resume_thread(ArchThreadContext &context)
     THROW_WIN32_IF_NOT(ResumeThread((HANDLE)context.NativeHandle._value) != (DWORD)(-1));
 }
 
+// The interrupt handlers may allocate and collect, so a thread is only left suspended at a GC safepoint
+void suspend_thread_at_safepoint(ArchThreadContext &context)
+{
+    suspend_thread(context);
+    auto gc_thread = reinterpret_cast<gc_thread_context *>(context.GCThread._value);
+    while (gc_thread && !gc_thread->at_safepoint())
+    {
+        resume_thread(context);
+        SwitchToThread();
+        suspend_thread(context);
+    }
+}
+
 void notify_interrupt()
 {
     g_interrupt_num.fetch_add(1);
@@ -93,7 +106,7 @@ void interrupt_sender_main(void *arg)
                 auto running_thread = ThreadScheduleEntry::get_Thread(running_thread_entry->item);
                 // Wait for suspended
                 context = Thread::get_Context(running_thread);
-                suspend_thread(*context);
+                suspend_thread_at_safepoint(*context);
             }
 
             g_interrupt_num.fetch_sub(1);
@@ -17,6 +17,7 @@ namespace
 uint32_t __stdcall thread_main_thunk(void *arg)
 {
     gc_obj_ref<Thread> thread(reinterpret_cast<Thread *>(arg));
+    Thread::get_Context(thread).cast<ArchThreadContext>()->GCThread = uintptr_t(&gc_current_thread());
     Thread::_s_ThreadMainThunk(thread);
     return Thread::get_ExitCode(thread);
 }
@@ -49,5 +50,9 @@ void ArchChipControl::UninitializeThreadContext(gc_obj_ref<ArchChipControl> _thi
     auto n_context = context.cast<ArchThreadContext>();
     auto handle = n_context->NativeHandle;
 
+    // Terminated threads never unwind, so their shadow stacks are dropped here
+    if (n_context->GCThread._value)
+        reinterpret_cast<gc_thread_context *>(n_context->GCThread._value)->detach();
+
     THROW_WIN32_IF_NOT(TerminateThread(handle._value, 0));
 }
@@ -43,7 +43,11 @@ gc_obj_ref<Accessor_1<Device>> get_device(gc_obj_ref<SafeFileHandle> handle)
 
 void KernelServiceHost::UserAppMain(gc_obj_ref<KernelServiceHost> _this)
 {
+    CHINO_APP_MODULE::init_statics();
     CHINO_APP_MODULE::CHINO_APP_NAMESPACE::Program::_s_Main(nullptr);
+#if NATSU_PROFILE
+    natsu::dump_profile();
+#endif
 }
 
 gc_obj_ref<SafeFileHandle> Interop_IO::_s_get_StdinHandle()
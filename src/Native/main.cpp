@@ -19,9 +19,13 @@ void InitializeHeap() noexcept;
 int main()
 {
     InitializeHeap();
+    // Statics the chip control depends on, the kernel ones need it
+    CHINO_CHIP_MODULE(CHINO_ARCH)::init_statics();
+    System_Collections::init_statics();
     System_Private_CoreLib::System::Activator::_s_CreateInstance<System_Collections::System::Collections::Generic::List_1<int32_t>>();
     // Initialize chip control
     ChipControl::_s_set_Default(make_object<ArchChipControl>());
+    Chino_Kernel::init_statics();
     KernelProgram::_s_KernelMain();
 
     // Should not reach here
@@ -52,7 +52,17 @@ void Array::_s_Copy(gc_obj_ref<Array> sourceArray, int32_t sourceIndex, gc_obj_r
 
     if (sourceArray.header().vtable_ != destinationArray.header().vtable_)
         throw_exception<ArrayTypeMismatchException>();
+
+    auto vtable = destinationArray.header().vtable_;
+    if (gc_marking && vtable->GCRefsCount)
+    {
+        for (int32_t i = 0; i < length; i++)
+            gc_shade_refs(&dest->Data + (size_t)(destinationIndex + i) * element_size, vtable->GCRefs, vtable->GCRefsCount);
+    }
+
     std::memmove(&dest->Data + (size_t)destinationIndex * element_size, &src->Data + (size_t)sourceIndex * element_size, (size_t)length * element_size);
+    if (length && vtable->GCRefsCount)
+        gc_cards.mark(&dest->Data + (size_t)destinationIndex * element_size, (size_t)length * element_size);
 }
 
 gc_ref<uint8_t> Array::_s_GetRawArrayGeometry(gc_obj_ref<Array> array, gc_ref<uint32_t> numComponents, gc_ref<uint32_t> elementSize, gc_ref<int32_t> lowerBound, ::natsu::gc_ref<bool> containsGCPointers)
@@ -60,10 +70,25 @@ gc_ref<uint8_t> Array::_s_GetRawArrayGeometry(gc_obj_ref<Array> array, gc_ref<ui
     *numComponents = (uint32_t)Array::GetLength(array, 0);
     *elementSize = array.header().vtable_->ElementSize;
     *lowerBound = Array::GetLowerBound(array, 0);
-    *containsGCPointers = true;
+    *containsGCPointers = array.header().vtable_->GCRefsCount != 0;
     return array.cast<RawSzArrayData>()->Data;
 }
 
+void Array::_s_ClearWithReferences(gc_obj_ref<Array> array, int32_t index, int32_t length)
+{
+    auto vtable = array.header().vtable_;
+    auto data = &array.cast<RawSzArrayData>()->Data + (size_t)index * vtable->ElementSize;
+
+    // Clearing drops references like a store does, the marker must still see what they held
+    if (gc_marking)
+    {
+        for (int32_t i = 0; i < length; i++)
+            gc_shade_refs(data + (size_t)i * vtable->ElementSize, vtable->GCRefs, vtable->GCRefsCount);
+    }
+
+    std::memset(data, 0, (size_t)length * vtable->ElementSize);
+}
+
 bool Array::_s_TrySZReverse(gc_obj_ref<Array> array, int32_t index, int32_t count)
 {
     check_null_obj_ref(array);
@@ -86,5 +111,7 @@ bool Array::_s_TrySZReverse(gc_obj_ref<Array> array, int32_t index, int32_t coun
         j--;
     }
 
+    if (count > 1 && array.header().vtable_->GCRefsCount)
+        gc_cards.mark(data + index * element_size, count * element_size);
     return true;
 }
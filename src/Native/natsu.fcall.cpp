@@ -52,6 +52,16 @@ void RuntimeImports::_s_RhZeroMemory(gc_ptr<void> b, uint64_t byteLength)
     std::memset(b.ptr_, 0, byteLength);
 }
 
+void RuntimeImports::_s_RhBulkMoveWithWriteBarrier(gc_ref<uint8_t> destination, gc_ref<uint8_t> source, uint64_t byteCount)
+{
+    if (gc_marking)
+        gc_shade_range(destination.ptr_, byteCount);
+
+    std::memmove(destination.ptr_, source.ptr_, byteCount);
+    if (byteCount)
+        gc_cards.mark(destination.ptr_, byteCount);
+}
+
 int32_t RuntimeHelpers::_s_GetHashCode(::natsu::gc_obj_ref<::System_Private_CoreLib::System::Object> o)
 {
     return (int32_t)o.ptr_;
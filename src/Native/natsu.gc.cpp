@@ -2,7 +2,12 @@
 // Chino Memory
 //
 #include "Chino.Kernel.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#if _MSC_VER
+#include <intrin.h>
+#endif
 
 #define traceMALLOC(p, size)
 #define traceFREE(p, size)
@@ -37,12 +42,23 @@
 #error "Invalid portBYTE_ALIGNMENT definition"
 #endif
 
+static_assert(portBYTE_ALIGNMENT == natsu::gc_alloc_alignment, "The heap alignment must match the inline allocation path.");
+
 /* Block sizes must not get too small. */
 #define heapMINIMUM_BLOCK_SIZE ((size_t)(heapStructSize_ << 1))
 
 /* Assumes 8bit bytes! */
 #define heapBITS_PER_BYTE ((size_t)8)
 
+#if CHINO_HEAP_TLSF
+typedef struct A_BLOCK_LINK
+{
+    A_BLOCK_LINK *pNextFreeBlock; /*<< The next free block in the same size class. */
+    size_t BlockSize; /*<< The size of the block. */
+    A_BLOCK_LINK *pPrevFreeBlock; /*<< The previous free block in the same size class. */
+    A_BLOCK_LINK *pPrevPhysBlock; /*<< The block physically in front of this one. */
+} BlockLink_t;
+#else
 typedef struct A_BLOCK_LINK
 {
     A_BLOCK_LINK *pNextFreeBlock; /*<< The next free block in the list. */
@@ -57,11 +73,15 @@ typedef struct A_BLOCK_LINK
 */
 static void prvInsertBlockIntoFreeList(BlockLink_t *pBlockToInsert);
 
+BlockLink_t heapStart_;
+#endif
+
 /*-----------------------------------------------------------*/
-BlockLink_t heapStart_, *pHeapEnd_ = nullptr;
+BlockLink_t *pHeapEnd_ = nullptr;
 size_t freeBytesRemaining_ = 0;
 size_t minimumEverFreeBytesRemaining_ = 0;
 size_t blockAllocatedBit_ = 0;
+BlockLink_t *pHeapRegionStart_ = nullptr;
 /* The size of the structure placed at the beginning of each allocated memory
 block must by correctly byte aligned. */
 static constexpr size_t heapStructSize_ = (sizeof(BlockLink_t) + ((size_t)(portBYTE_ALIGNMENT - 1))) & ~((size_t)portBYTE_ALIGNMENT_MASK);
@@ -89,6 +109,7 @@ extern "C"
             ;        \
     }
 
+#if !CHINO_HEAP_TLSF
 void InitializeHeap() noexcept
 {
     if (pHeapEnd_)
@@ -123,6 +144,7 @@ void InitializeHeap() noexcept
         }
 
         alignedHeap = address;
+        pHeapRegionStart_ = reinterpret_cast<BlockLink_t *>(alignedHeap);
 
         /* Set xStart if it has not already been set. */
         if (definedRegions == 0)
@@ -388,30 +410,1524 @@ static void prvInsertBlockIntoFreeList(BlockLink_t *pBlockToInsert)
     }
 }
 
+/*
+* The collector rebuilds the free list in address order while it sweeps, so
+* runs of free blocks are simply appended after the previous one.
+*/
+static BlockLink_t *pRebuildTail_ = nullptr;
+
+static void prvBeginFreeListRebuild()
+{
+    pRebuildTail_ = &heapStart_;
+}
+
+static void prvAppendFreeRun(BlockLink_t *pFreeRun)
+{
+    pRebuildTail_->pNextFreeBlock = pFreeRun;
+    pRebuildTail_ = pFreeRun;
+}
+
+static void prvLinkPhysicalBlock(BlockLink_t *, BlockLink_t *)
+{
+}
+
+static void prvEndFreeListRebuild(BlockLink_t *)
+{
+    pRebuildTail_->pNextFreeBlock = pHeapEnd_;
+}
+
+static size_t prvGetLargestFreeBlockSize() noexcept
+{
+    size_t largest = 0;
+    for (auto pBlock = heapStart_.pNextFreeBlock; pBlock && pBlock != pHeapEnd_; pBlock = pBlock->pNextFreeBlock)
+    {
+        if (pBlock->BlockSize > largest)
+            largest = pBlock->BlockSize;
+    }
+
+    return largest;
+}
+#else
+/*
+* Two-level segregated fit heap. Free blocks are kept in size classes indexed
+* by their most significant bit and the next bits below it, so finding,
+* splitting and coalescing a block take a bounded number of steps.
+*/
+static constexpr int tlsfSLIndexCountLog2_ = 4;
+static constexpr int tlsfSLIndexCount_ = 1 << tlsfSLIndexCountLog2_;
+static constexpr int tlsfAlignSizeLog2_ = 3;
+static constexpr int tlsfFLIndexShift_ = tlsfSLIndexCountLog2_ + tlsfAlignSizeLog2_;
+static constexpr int tlsfFLIndexMax_ = 32;
+static constexpr int tlsfFLIndexCount_ = tlsfFLIndexMax_ - tlsfFLIndexShift_ + 1;
+static constexpr size_t tlsfSmallBlockSize_ = size_t(1) << tlsfFLIndexShift_;
+
+static_assert((size_t(1) << tlsfAlignSizeLog2_) == portBYTE_ALIGNMENT, "TLSF alignment must match the heap alignment.");
+
+static uint32_t tlsfFLBitmap_ = 0;
+static uint32_t tlsfSLBitmap_[tlsfFLIndexCount_];
+static BlockLink_t *tlsfBlocks_[tlsfFLIndexCount_][tlsfSLIndexCount_];
+
+static int prvFindFirstSet(uint32_t word) noexcept
+{
+#if _MSC_VER
+    unsigned long index;
+    return _BitScanForward(&index, word) ? int(index) : -1;
+#else
+    return word ? __builtin_ctz(word) : -1;
+#endif
+}
+
+static int prvFindLastSet(size_t word) noexcept
+{
+#if _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    return _BitScanReverse64(&index, word) ? int(index) : -1;
+#else
+    return _BitScanReverse(&index, word) ? int(index) : -1;
+#endif
+#else
+    return word ? int(sizeof(size_t) * heapBITS_PER_BYTE - 1 - __builtin_clzl(word)) : -1;
+#endif
+}
+
+static BlockLink_t *prvNextPhysicalBlock(BlockLink_t *pBlock) noexcept
+{
+    return reinterpret_cast<BlockLink_t *>(uintptr_t(pBlock) + (pBlock->BlockSize & ~blockAllocatedBit_));
+}
+
+/* Gets the size class a free block of the given size is kept in. */
+static void prvMappingInsert(size_t size, int &fl, int &sl) noexcept
+{
+    if (size < tlsfSmallBlockSize_)
+    {
+        fl = 0;
+        sl = int(size / (tlsfSmallBlockSize_ / tlsfSLIndexCount_));
+    }
+    else
+    {
+        fl = prvFindLastSet(size);
+        sl = int(size >> (fl - tlsfSLIndexCountLog2_)) ^ tlsfSLIndexCount_;
+        fl -= tlsfFLIndexShift_ - 1;
+    }
+}
+
+/* Gets the first size class whose blocks are all large enough for the given size. */
+static void prvMappingSearch(size_t size, int &fl, int &sl) noexcept
+{
+    if (size >= tlsfSmallBlockSize_)
+        size += (size_t(1) << (prvFindLastSet(size) - tlsfSLIndexCountLog2_)) - 1;
+    prvMappingInsert(size, fl, sl);
+}
+
+static BlockLink_t *prvSearchSuitableBlock(int &fl, int &sl) noexcept
+{
+    if (fl >= tlsfFLIndexCount_)
+        return nullptr;
+
+    auto slMap = tlsfSLBitmap_[fl] & (~uint32_t(0) << sl);
+    if (!slMap)
+    {
+        /* No block in this first level, use the next larger one. */
+        auto flMap = tlsfFLBitmap_ & (~uint32_t(0) << (fl + 1));
+        if (!flMap)
+            return nullptr;
+
+        fl = prvFindFirstSet(flMap);
+        slMap = tlsfSLBitmap_[fl];
+    }
+
+    sl = prvFindFirstSet(slMap);
+    return tlsfBlocks_[fl][sl];
+}
+
+static void prvInsertFreeBlock(BlockLink_t *pBlock) noexcept
+{
+    int fl, sl;
+    prvMappingInsert(pBlock->BlockSize, fl, sl);
+
+    auto pHead = tlsfBlocks_[fl][sl];
+    pBlock->pNextFreeBlock = pHead;
+    pBlock->pPrevFreeBlock = nullptr;
+    if (pHead)
+        pHead->pPrevFreeBlock = pBlock;
+
+    tlsfBlocks_[fl][sl] = pBlock;
+    tlsfFLBitmap_ |= uint32_t(1) << fl;
+    tlsfSLBitmap_[fl] |= uint32_t(1) << sl;
+}
+
+static void prvRemoveFreeBlock(BlockLink_t *pBlock) noexcept
+{
+    int fl, sl;
+    prvMappingInsert(pBlock->BlockSize, fl, sl);
+
+    auto pPrev = pBlock->pPrevFreeBlock;
+    auto pNext = pBlock->pNextFreeBlock;
+    if (pNext)
+        pNext->pPrevFreeBlock = pPrev;
+
+    if (pPrev)
+    {
+        pPrev->pNextFreeBlock = pNext;
+    }
+    else
+    {
+        tlsfBlocks_[fl][sl] = pNext;
+        if (!pNext)
+        {
+            tlsfSLBitmap_[fl] &= ~(uint32_t(1) << sl);
+            if (!tlsfSLBitmap_[fl])
+                tlsfFLBitmap_ &= ~(uint32_t(1) << fl);
+        }
+    }
+}
+
+void InitializeHeap() noexcept
+{
+    if (pHeapEnd_)
+        return;
+
+    uintptr_t address;
+    size_t totalRegionSize;
+
+    HeapRegionDesc regionDesc;
+#ifdef WIN32
+    regionDesc.StartAddress = uintptr_t(&_sram[0]);
+    regionDesc.SizeInBytes = size_t(std::size(_sram));
+#else
+    regionDesc.StartAddress = uintptr_t(&_heap_start[0]);
+    regionDesc.SizeInBytes = size_t(&_heap_end[0] - &_heap_start[0]);
+#endif
+    totalRegionSize = regionDesc.SizeInBytes;
+    address = regionDesc.StartAddress;
+    /* Ensure the heap region starts on a correctly aligned boundary. */
+    if ((address & portBYTE_ALIGNMENT_MASK) != 0)
+    {
+        address += (portBYTE_ALIGNMENT - 1);
+        address &= ~portBYTE_ALIGNMENT_MASK;
+        totalRegionSize -= address - (size_t)regionDesc.StartAddress;
+    }
+
+    pHeapRegionStart_ = reinterpret_cast<BlockLink_t *>(address);
+
+    /* Work out the position of the top bit in a size_t variable. */
+    blockAllocatedBit_ = ((size_t)1) << ((sizeof(size_t) * heapBITS_PER_BYTE) - 1);
+
+    /* The end marker is an allocated empty block, so no block ever merges with it. */
+    address += totalRegionSize;
+    address -= heapStructSize_;
+    address &= ~portBYTE_ALIGNMENT_MASK;
+    pHeapEnd_ = reinterpret_cast<BlockLink_t *>(address);
+    pHeapEnd_->BlockSize = blockAllocatedBit_;
+    pHeapEnd_->pNextFreeBlock = nullptr;
+
+    /* To start with there is a single free block that takes up the entire heap. */
+    auto pFirstFreeBlock = pHeapRegionStart_;
+    pFirstFreeBlock->BlockSize = address - uintptr_t(pFirstFreeBlock);
+    pFirstFreeBlock->pPrevPhysBlock = nullptr;
+    pHeapEnd_->pPrevPhysBlock = pFirstFreeBlock;
+    prvInsertFreeBlock(pFirstFreeBlock);
+
+    minimumEverFreeBytesRemaining_ = pFirstFreeBlock->BlockSize;
+    freeBytesRemaining_ = pFirstFreeBlock->BlockSize;
+
+    /* Check something was actually defined before it is accessed. */
+    kassert(freeBytesRemaining_);
+}
+
+void *HeapAlloc(size_t wantedSize) noexcept
+{
+#ifdef WIN32
+    InitializeHeap();
+#endif
+
+    BlockLink_t *pBlock, *pNewBlockLink;
+    int fl, sl;
+
+    kassert(pHeapEnd_);
+
+    if (wantedSize == 0 || (wantedSize & blockAllocatedBit_) != 0)
+        return nullptr;
+
+    /* The wanted size is increased so it can contain a BlockLink_t structure
+    in addition to the requested amount of bytes, and is kept aligned. */
+    wantedSize += heapStructSize_;
+    if ((wantedSize & portBYTE_ALIGNMENT_MASK) != 0x00)
+        wantedSize += (portBYTE_ALIGNMENT - (wantedSize & portBYTE_ALIGNMENT_MASK));
+    if (wantedSize < heapMINIMUM_BLOCK_SIZE)
+        wantedSize = heapMINIMUM_BLOCK_SIZE;
+
+    if (wantedSize > freeBytesRemaining_)
+        return nullptr;
+
+    prvMappingSearch(wantedSize, fl, sl);
+    pBlock = prvSearchSuitableBlock(fl, sl);
+    if (!pBlock)
+        return nullptr;
+
+    prvRemoveFreeBlock(pBlock);
+
+    /* If the block is larger than required it can be split into two. */
+    if ((pBlock->BlockSize - wantedSize) >= heapMINIMUM_BLOCK_SIZE)
+    {
+        pNewBlockLink = reinterpret_cast<BlockLink_t *>(uintptr_t(pBlock) + wantedSize);
+        pNewBlockLink->BlockSize = pBlock->BlockSize - wantedSize;
+        pNewBlockLink->pPrevPhysBlock = pBlock;
+        prvNextPhysicalBlock(pNewBlockLink)->pPrevPhysBlock = pNewBlockLink;
+        pBlock->BlockSize = wantedSize;
+        prvInsertFreeBlock(pNewBlockLink);
+    }
+
+    freeBytesRemaining_ -= pBlock->BlockSize;
+
+    if (freeBytesRemaining_ < minimumEverFreeBytesRemaining_)
+        minimumEverFreeBytesRemaining_ = freeBytesRemaining_;
+
+    /* The block is being returned - it is allocated and owned by the
+    application and has no "next" block. */
+    pBlock->BlockSize |= blockAllocatedBit_;
+    pBlock->pNextFreeBlock = nullptr;
+    return reinterpret_cast<void *>(uintptr_t(pBlock) + heapStructSize_);
+}
+
+void HeapFree(void *ptr) noexcept
+{
+    if (!ptr)
+        return;
+
+    /* The memory being freed will have an BlockLink_t structure immediately
+    before it. */
+    auto pLink = reinterpret_cast<BlockLink_t *>(uintptr_t(ptr) - heapStructSize_);
+
+    /* Check the block is actually allocated. */
+    kassert(pLink->BlockSize & blockAllocatedBit_);
+    kassert(pLink->pNextFreeBlock == nullptr);
+
+    pLink->BlockSize &= ~blockAllocatedBit_;
+    freeBytesRemaining_ += pLink->BlockSize;
+
+    /* Merge with the free blocks physically in front of and behind it. */
+    auto pPrev = pLink->pPrevPhysBlock;
+    if (pPrev && !(pPrev->BlockSize & blockAllocatedBit_))
+    {
+        prvRemoveFreeBlock(pPrev);
+        pPrev->BlockSize += pLink->BlockSize;
+        pLink = pPrev;
+    }
+
+    auto pNext = prvNextPhysicalBlock(pLink);
+    if (!(pNext->BlockSize & blockAllocatedBit_))
+    {
+        prvRemoveFreeBlock(pNext);
+        pLink->BlockSize += pNext->BlockSize;
+    }
+
+    prvNextPhysicalBlock(pLink)->pPrevPhysBlock = pLink;
+    prvInsertFreeBlock(pLink);
+}
+
+/*
+* The collector rebuilds the size classes while it sweeps, free runs are
+* inserted once they are fully coalesced.
+*/
+static void prvBeginFreeListRebuild()
+{
+    tlsfFLBitmap_ = 0;
+    for (auto &bitmap : tlsfSLBitmap_)
+        bitmap = 0;
+    for (auto &blocks : tlsfBlocks_)
+    {
+        for (auto &pBlock : blocks)
+            pBlock = nullptr;
+    }
+}
+
+static void prvAppendFreeRun(BlockLink_t *pFreeRun)
+{
+    prvInsertFreeBlock(pFreeRun);
+}
+
+static void prvLinkPhysicalBlock(BlockLink_t *pBlock, BlockLink_t *pPrevPhysBlock)
+{
+    pBlock->pPrevPhysBlock = pPrevPhysBlock;
+}
+
+static void prvEndFreeListRebuild(BlockLink_t *pLastBlock)
+{
+    pHeapEnd_->pPrevPhysBlock = pLastBlock;
+}
+
+/* The largest block is in the highest size class that is not empty. */
+static size_t prvGetLargestFreeBlockSize() noexcept
+{
+    if (!tlsfFLBitmap_)
+        return 0;
+
+    auto fl = prvFindLastSet(tlsfFLBitmap_);
+    auto sl = prvFindLastSet(tlsfSLBitmap_[fl]);
+    size_t largest = 0;
+    for (auto pBlock = tlsfBlocks_[fl][sl]; pBlock; pBlock = pBlock->pNextFreeBlock)
+    {
+        if (pBlock->BlockSize > largest)
+            largest = pBlock->BlockSize;
+    }
+
+    return largest;
+}
+#endif
+
 using namespace System_Private_CoreLib::System;
+using namespace System_Private_CoreLib::System::Runtime::CompilerServices;
 using namespace Chino_Core::Chino::Memory;
 using namespace natsu;
 
-gc_obj_ref<Object> natsu::gc_alloc(const clr_vtable &vtable, size_t size)
+/*
+* Managed objects are allocated from the same heap as malloc, the allocated
+* block link of an object is tagged so the collector can tell them apart.
+*/
+static BlockLink_t *const pManagedBlockTag_ = reinterpret_cast<BlockLink_t *>(1);
+
+/* Bytes allocated since the last collection that trigger a new collection. */
+static constexpr size_t gcAllocationBudget_ = 512 * 1024;
+static size_t gcAllocatedBytes_ = 0;
+
+/*
+* Objects surviving a collection are promoted to the old generation. Minor
+* collections trace from the roots and the old objects in dirty cards only,
+* a full collection runs once enough bytes got promoted.
+*/
+static constexpr size_t gcPromotionBudget_ = 1024 * 1024;
+static size_t gcPromotedBytes_ = 0;
+static bool gcMinorCollection_ = false;
+static bool gcCardsInitialized_ = false;
+static size_t gcCardsCount_ = 0;
+
+/*
+* Byrefs are gathered and resolved to the objects containing them in batches,
+* sorted so a single walk over the heap finds all of their blocks.
+*/
+static constexpr size_t gcInteriorBatchSize_ = 64;
+static uintptr_t gcInteriorPtrs_[gcInteriorBatchSize_];
+static size_t gcInteriorPtrsCount_ = 0;
+
+/* Explicit mark stack, a rescan of the heap is done when it overflows. */
+static constexpr size_t gcMarkStackSize_ = 256;
+static Object *gcMarkStack_[gcMarkStackSize_];
+static size_t gcMarkStackTop_ = 0;
+static bool gcMarkStackOverflow_ = false;
+
+/*
+* Incremental marking steps scan batches of objects until the maximum pause
+* is reached. Without a clock only the batch limit bounds a step. A maximum
+* pause of 0 makes every full collection stop the world.
+*/
+static constexpr size_t gcMarkBatchObjects_ = 32;
+static constexpr size_t gcMarkStepBatches_ = 64;
+static uint32_t gcMaxPauseUs_ = 1000;
+static uint32_t gcLongestPauseUs_ = 0;
+
+#ifdef WIN32
+static uint64_t gc_clock_us() noexcept
 {
-    auto mem_ptr = reinterpret_cast<uint8_t *>(HeapAlloc(size + sizeof(object_header)));
-    if (!mem_ptr)
-        throw make_exception(make_object<OutOfMemoryException>());
-    gc_obj_ref<Object> ptr(reinterpret_cast<Object *>(mem_ptr + sizeof(object_header)));
-    new (&ptr.header()) object_header(OBJ_ATTR_NONE, &vtable);
-    return ptr;
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
 }
+#else
+/* Boards with a free running timer provide it in microseconds. */
+extern "C" __attribute__((weak)) uint64_t chino_clock_us() noexcept;
 
-int32_t MemoryManager::_s_GetUsedMemorySize()
+static uint64_t gc_clock_us() noexcept
 {
-#if _WIN32
-    return 6 * 1024 * 1024 - freeBytesRemaining_;
-#else
-    return size_t(&_heap_end[0] - &_heap_start[0]) - freeBytesRemaining_;
+    return chino_clock_us ? chino_clock_us() : 0;
+}
 #endif
+
+static gc_static_root *gcStaticRoots_ = nullptr;
+static gc_thread_context *gcThreads_ = nullptr;
+static std::atomic_flag gcThreadsLock_ = ATOMIC_FLAG_INIT;
+static std::atomic<gc_alloc_stats *> gcAllocatedTypes_ = nullptr;
+
+static void tlab_retire(gc_thread_context &thread) noexcept;
+
+gc_static_root::gc_static_root(const void *base, const uint32_t *refs, uint32_t refs_count) noexcept
+    : root_ { base, refs, refs_count }
+{
+    while (gcThreadsLock_.test_and_set(std::memory_order_acquire))
+        ;
+    next_ = gcStaticRoots_;
+    gcStaticRoots_ = this;
+    gcThreadsLock_.clear(std::memory_order_release);
 }
 
-int32_t MemoryManager::_s_GetFreeMemorySize()
+gc_thread_context::gc_thread_context() noexcept
+    : frames_(nullptr), prev_(nullptr)
 {
-    return freeBytesRemaining_;
+    while (gcThreadsLock_.test_and_set(std::memory_order_acquire))
+        ;
+    next_ = gcThreads_;
+    if (next_)
+        next_->prev_ = this;
+    gcThreads_ = this;
+    gcThreadsLock_.clear(std::memory_order_release);
+}
+
+gc_thread_context::~gc_thread_context()
+{
+    detach();
+}
+
+void gc_thread_context::detach() noexcept
+{
+    while (gcThreadsLock_.test_and_set(std::memory_order_acquire))
+        ;
+    if (prev_ || gcThreads_ == this)
+    {
+        tlab_retire(*this);
+        if (prev_)
+            prev_->next_ = next_;
+        else
+            gcThreads_ = next_;
+        if (next_)
+            next_->prev_ = prev_;
+        prev_ = next_ = nullptr;
+        frames_ = nullptr;
+    }
+
+    gcThreadsLock_.clear(std::memory_order_release);
+}
+
+/*
+* Small objects are served from size-segregated slab pages carved out of the
+* heap, so allocating them never walks the free list. Objects whose unit fits
+* a thread allocation buffer never get here, so the classes start where the
+* buffers stop.
+*/
+static BlockLink_t *const pSlabBlockTag_ = reinterpret_cast<BlockLink_t *>(2);
+static constexpr size_t slabPageSize_ = 4096;
+static constexpr size_t slabMaxSize_ = 512;
+static constexpr size_t slabClassSizes_[] = { 256, 320, 384, 448, 512 };
+static constexpr size_t slabClassesCount_ = std::size(slabClassSizes_);
+
+typedef struct A_SLAB_SLOT
+{
+    A_SLAB_SLOT *pNextFreeSlot; /*<< Overlaps the object header, the vtable of a free slot stays null. */
+} SlabSlot_t;
+
+typedef struct A_SLAB_PAGE
+{
+    A_SLAB_PAGE *pNextPage; /*<< The next page of the same size class with free slots. */
+    SlabSlot_t *pFreeSlots;
+    uint32_t SizeClass;
+    uint32_t UsedSlots;
+} SlabPage_t;
+
+static constexpr size_t slabPageStructSize_ = (sizeof(SlabPage_t) + ((size_t)(portBYTE_ALIGNMENT - 1))) & ~((size_t)portBYTE_ALIGNMENT_MASK);
+
+/* Maps (size + 7) / 8 to its size class. */
+static constexpr auto slabClassTable_ = [] {
+    std::array<uint8_t, slabMaxSize_ / 8 + 1> table {};
+    size_t sizeClass = 0;
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        while (slabClassSizes_[sizeClass] < i * 8)
+            sizeClass++;
+        table[i] = uint8_t(sizeClass);
+    }
+
+    return table;
+}();
+
+static SlabPage_t *slabPartialPages_[slabClassesCount_];
+
+static SlabPage_t *slab_page_of(BlockLink_t *block) noexcept
+{
+    return reinterpret_cast<SlabPage_t *>(reinterpret_cast<uint8_t *>(block) + heapStructSize_);
+}
+
+static uint8_t *slab_first_slot(SlabPage_t *page) noexcept
+{
+    return reinterpret_cast<uint8_t *>(page) + slabPageStructSize_;
+}
+
+static size_t slab_slots_count(SlabPage_t *page) noexcept
+{
+    return (slabPageSize_ - heapStructSize_ - slabPageStructSize_) / slabClassSizes_[page->SizeClass];
+}
+
+static uint8_t *slab_alloc(size_t size) noexcept
+{
+    auto sizeClass = slabClassTable_[(size + 7) / 8];
+    auto page = slabPartialPages_[sizeClass];
+    if (!page)
+    {
+        auto mem = reinterpret_cast<uint8_t *>(HeapAlloc(slabPageSize_ - heapStructSize_));
+        if (!mem)
+            return nullptr;
+
+        reinterpret_cast<BlockLink_t *>(mem - heapStructSize_)->pNextFreeBlock = pSlabBlockTag_;
+        page = reinterpret_cast<SlabPage_t *>(mem);
+        page->pNextPage = nullptr;
+        page->pFreeSlots = nullptr;
+        page->SizeClass = uint32_t(sizeClass);
+        page->UsedSlots = 0;
+
+        auto slotSize = slabClassSizes_[sizeClass];
+        auto slotsCount = slab_slots_count(page);
+        auto slot = slab_first_slot(page) + slotsCount * slotSize;
+        std::memset(slab_first_slot(page), 0, slotsCount * slotSize);
+        for (size_t i = 0; i < slotsCount; i++)
+        {
+            slot -= slotSize;
+            auto freeSlot = reinterpret_cast<SlabSlot_t *>(slot);
+            freeSlot->pNextFreeSlot = page->pFreeSlots;
+            page->pFreeSlots = freeSlot;
+        }
+
+        slabPartialPages_[sizeClass] = page;
+    }
+
+    auto slot = page->pFreeSlots;
+    page->pFreeSlots = slot->pNextFreeSlot;
+    page->UsedSlots++;
+
+    /* Full pages leave the partial list until a collection frees some slots. */
+    if (!page->pFreeSlots)
+        slabPartialPages_[sizeClass] = page->pNextPage;
+    return reinterpret_cast<uint8_t *>(slot);
+}
+
+/*
+* Each thread bump-allocates small objects from its own allocation buffer, a
+* hole of free space inside a chunk carved out of the heap. Every unit in a
+* chunk starts with its size so the collector can walk it, holes have the low
+* bit of the size set and are kept zeroed after their size.
+*/
+static BlockLink_t *const pTlabBlockTag_ = reinterpret_cast<BlockLink_t *>(3);
+static constexpr size_t tlabChunkSize_ = 8192;
+static constexpr size_t tlabMaxUnitSize_ = gc_tlab_max_unit_size;
+static constexpr size_t tlabHoleBit_ = 1;
+
+typedef struct TLAB_CHUNK
+{
+    TLAB_CHUNK *pNextChunk; /*<< The next chunk with holes left by the collector. */
+} TlabChunk_t;
+
+static constexpr size_t tlabChunkStructSize_ = (sizeof(TlabChunk_t) + ((size_t)(portBYTE_ALIGNMENT - 1))) & ~((size_t)portBYTE_ALIGNMENT_MASK);
+
+/* Chunks the last collection left holes in, threads refill from them first. */
+static TlabChunk_t *tlabRecyclableChunks_ = nullptr;
+
+static TlabChunk_t *tlab_chunk_of(BlockLink_t *block) noexcept
+{
+    return reinterpret_cast<TlabChunk_t *>(reinterpret_cast<uint8_t *>(block) + heapStructSize_);
+}
+
+static uint8_t *tlab_first_unit(TlabChunk_t *chunk) noexcept
+{
+    return reinterpret_cast<uint8_t *>(chunk) + tlabChunkStructSize_;
+}
+
+static uint8_t *tlab_chunk_end(TlabChunk_t *chunk) noexcept
+{
+    return reinterpret_cast<uint8_t *>(chunk) - heapStructSize_ + tlabChunkSize_;
+}
+
+/* Adds an allocation to its type's statistics, listing the type the first time. */
+static void gc_count_alloc(const clr_vtable &vtable, size_t size) noexcept
+{
+    auto &stats = *vtable.AllocStats;
+    if (!stats.count.fetch_add(1, std::memory_order_relaxed))
+    {
+        stats.vtable = &vtable;
+        stats.next = gcAllocatedTypes_.load(std::memory_order_relaxed);
+        while (!gcAllocatedTypes_.compare_exchange_weak(stats.next, &stats, std::memory_order_release, std::memory_order_relaxed))
+            ;
+    }
+
+    stats.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+/* Counts the units bumped off the thread's buffer since it was last counted, their sizes include the alignment padding. */
+static void tlab_count(gc_thread_context &thread) noexcept
+{
+    for (auto unit = thread.alloc_counted_; unit < thread.alloc_ptr_;)
+    {
+        auto size = reinterpret_cast<gc_tlab_unit *>(unit)->size_;
+        auto header = reinterpret_cast<object_header *>(unit + sizeof(gc_tlab_unit));
+        gc_count_alloc(*header->vtable_, size - sizeof(gc_tlab_unit) - sizeof(object_header));
+        unit += size;
+    }
+
+    thread.alloc_counted_ = thread.alloc_ptr_;
+}
+
+/* Gives the unused rest of the thread's buffer back to its chunk as a hole. */
+static void tlab_retire(gc_thread_context &thread) noexcept
+{
+    tlab_count(thread);
+    if (thread.alloc_ptr_ != thread.alloc_limit_)
+        reinterpret_cast<gc_tlab_unit *>(thread.alloc_ptr_)->size_ = size_t(thread.alloc_limit_ - thread.alloc_ptr_) | tlabHoleBit_;
+    thread.alloc_ptr_ = thread.alloc_limit_;
+}
+
+static TlabChunk_t *tlab_new_chunk() noexcept
+{
+    auto mem = reinterpret_cast<uint8_t *>(HeapAlloc(tlabChunkSize_ - heapStructSize_));
+    if (!mem)
+        return nullptr;
+
+    reinterpret_cast<BlockLink_t *>(mem - heapStructSize_)->pNextFreeBlock = pTlabBlockTag_;
+    auto chunk = reinterpret_cast<TlabChunk_t *>(mem);
+    chunk->pNextChunk = nullptr;
+
+    auto first = tlab_first_unit(chunk);
+    auto unitsSize = size_t(tlab_chunk_end(chunk) - first);
+    std::memset(first, 0, unitsSize);
+    reinterpret_cast<gc_tlab_unit *>(first)->size_ = unitsSize | tlabHoleBit_;
+    return chunk;
+}
+
+/* Moves the thread's buffer to the next hole that fits the unit. */
+static bool tlab_refill(gc_thread_context &thread, size_t unitSize) noexcept
+{
+    tlab_retire(thread);
+    while (true)
+    {
+        for (auto unit = thread.alloc_limit_; unit < thread.alloc_end_;)
+        {
+            auto size = reinterpret_cast<gc_tlab_unit *>(unit)->size_;
+            auto holeSize = size & ~tlabHoleBit_;
+            if ((size & tlabHoleBit_) && holeSize >= unitSize)
+            {
+                thread.alloc_ptr_ = thread.alloc_counted_ = unit;
+                thread.alloc_limit_ = unit + holeSize;
+                gcAllocatedBytes_ += holeSize;
+                return true;
+            }
+
+            unit += holeSize;
+        }
+
+        /* Continue with a chunk recycled by the last collection, or a new one. */
+        auto chunk = tlabRecyclableChunks_;
+        if (chunk)
+            tlabRecyclableChunks_ = chunk->pNextChunk;
+        else if (!(chunk = tlab_new_chunk()))
+            return false;
+
+        thread.alloc_ptr_ = thread.alloc_limit_ = tlab_first_unit(chunk);
+        thread.alloc_end_ = tlab_chunk_end(chunk);
+    }
+}
+
+/* Bumps a unit off a buffer that has room for it, like the inline gc_alloc does. */
+static gc_obj_ref<Object> tlab_alloc(gc_thread_context &thread, const clr_vtable &vtable, size_t unitSize) noexcept
+{
+    auto unit = reinterpret_cast<gc_tlab_unit *>(thread.alloc_ptr_);
+    thread.alloc_ptr_ += unitSize;
+    unit->size_ = unitSize;
+    auto header = new (unit + 1) object_header(gc_alloc_attributes, &vtable);
+    return gc_obj_ref<Object>(reinterpret_cast<Object *>(header + 1));
+}
+
+static object_header &gc_header_of(BlockLink_t *block) noexcept
+{
+    return *reinterpret_cast<object_header *>(reinterpret_cast<uint8_t *>(block) + heapStructSize_);
+}
+
+static Object *gc_object_of(object_header &header) noexcept
+{
+    return reinterpret_cast<Object *>(&header + 1);
+}
+
+/* Calls fn(header, size) for each object allocated in a heap block, the size includes the header. */
+template <class TFunc>
+static void gc_for_each_object(BlockLink_t *block, TFunc &&fn)
+{
+    if (block->pNextFreeBlock == pManagedBlockTag_)
+    {
+        fn(gc_header_of(block), (block->BlockSize & ~blockAllocatedBit_) - heapStructSize_);
+    }
+    else if (block->pNextFreeBlock == pSlabBlockTag_)
+    {
+        auto page = slab_page_of(block);
+        auto slotSize = slabClassSizes_[page->SizeClass];
+        auto slot = slab_first_slot(page);
+        for (size_t i = 0; i < slab_slots_count(page); i++, slot += slotSize)
+        {
+            auto &header = *reinterpret_cast<object_header *>(slot);
+            if (header.vtable_)
+                fn(header, slotSize);
+        }
+    }
+    else if (block->pNextFreeBlock == pTlabBlockTag_)
+    {
+        auto chunk = tlab_chunk_of(block);
+        for (auto unit = tlab_first_unit(chunk); unit < tlab_chunk_end(chunk);)
+        {
+            auto size = reinterpret_cast<gc_tlab_unit *>(unit)->size_;
+            if (!(size & tlabHoleBit_))
+                fn(*reinterpret_cast<object_header *>(unit + sizeof(gc_tlab_unit)), size - sizeof(gc_tlab_unit));
+            unit += size & ~tlabHoleBit_;
+        }
+    }
+}
+
+static bool gc_cards_dirty(const void *begin, size_t size) noexcept
+{
+    auto offset = uintptr_t(begin) - gc_cards.heap_base_;
+    auto last = (offset + size - 1) >> gc_card_table::card_shift;
+    for (auto card = offset >> gc_card_table::card_shift; card <= last; card++)
+    {
+        if (gc_cards.cards_[card])
+            return true;
+    }
+
+    return false;
+}
+
+static void gc_init_cards() noexcept
+{
+    gcCardsInitialized_ = true;
+    auto heapSize = size_t(uintptr_t(pHeapEnd_) - uintptr_t(pHeapRegionStart_));
+    auto cardsCount = (heapSize >> gc_card_table::card_shift) + 1;
+    auto cards = reinterpret_cast<uint8_t *>(HeapAlloc(cardsCount));
+
+    /* Without a card table every collection is a full one. */
+    if (cards)
+    {
+        std::memset(cards, 0, cardsCount);
+        gc_cards.heap_base_ = uintptr_t(pHeapRegionStart_);
+        gc_cards.heap_size_ = heapSize;
+        gc_cards.cards_ = cards;
+        gcCardsCount_ = cardsCount;
+    }
+}
+
+static void gc_mark_object(Object *obj) noexcept
+{
+    /* Objects outside the heap (string literals, runtime types) are never collected. */
+    if (!obj || uintptr_t(obj) <= uintptr_t(pHeapRegionStart_) || uintptr_t(obj) >= uintptr_t(pHeapEnd_))
+        return;
+
+    auto &header = gc_obj_ref<Object>(obj).header();
+    if (header.attributes_ & OBJ_ATTR_MARKED)
+        return;
+
+    /* Old objects are live until the next full collection. */
+    if (gcMinorCollection_ && (header.attributes_ & OBJ_ATTR_OLD))
+        return;
+
+    header.attributes_ = object_attributes(header.attributes_ | OBJ_ATTR_MARKED);
+    if (gcMarkStackTop_ < gcMarkStackSize_)
+        gcMarkStack_[gcMarkStackTop_++] = obj;
+    else
+        gcMarkStackOverflow_ = true;
+}
+
+/* Gets the object an interior pointer of an allocated heap block points into. */
+static Object *gc_object_containing(BlockLink_t *block, uintptr_t ptr) noexcept
+{
+    if (block->pNextFreeBlock == pManagedBlockTag_)
+    {
+        return gc_object_of(gc_header_of(block));
+    }
+    else if (block->pNextFreeBlock == pSlabBlockTag_)
+    {
+        auto page = slab_page_of(block);
+        auto first = uintptr_t(slab_first_slot(page));
+        auto index = ptr >= first ? (ptr - first) / slabClassSizes_[page->SizeClass] : SIZE_MAX;
+        if (index >= slab_slots_count(page))
+            return nullptr;
+
+        auto &header = *reinterpret_cast<object_header *>(first + index * slabClassSizes_[page->SizeClass]);
+        return header.vtable_ ? gc_object_of(header) : nullptr;
+    }
+    else if (block->pNextFreeBlock == pTlabBlockTag_)
+    {
+        auto chunk = tlab_chunk_of(block);
+        for (auto unit = tlab_first_unit(chunk); unit < tlab_chunk_end(chunk);)
+        {
+            auto size = reinterpret_cast<gc_tlab_unit *>(unit)->size_;
+            auto next = unit + (size & ~tlabHoleBit_);
+            if (ptr < uintptr_t(next))
+                return (size & tlabHoleBit_) ? nullptr : gc_object_of(*reinterpret_cast<object_header *>(unit + sizeof(gc_tlab_unit)));
+            unit = next;
+        }
+    }
+
+    return nullptr;
+}
+
+static void gc_mark_interior_ptrs() noexcept
+{
+    std::sort(gcInteriorPtrs_, gcInteriorPtrs_ + gcInteriorPtrsCount_);
+    size_t i = 0;
+    for (auto block = pHeapRegionStart_; block < pHeapEnd_ && i < gcInteriorPtrsCount_;)
+    {
+        auto next = uintptr_t(block) + (block->BlockSize & ~blockAllocatedBit_);
+        for (; i < gcInteriorPtrsCount_ && gcInteriorPtrs_[i] < next; i++)
+        {
+            if ((block->BlockSize & blockAllocatedBit_) && gcInteriorPtrs_[i] >= uintptr_t(block) + heapStructSize_)
+                gc_mark_object(gc_object_containing(block, gcInteriorPtrs_[i]));
+        }
+
+        block = reinterpret_cast<BlockLink_t *>(next);
+    }
+
+    gcInteriorPtrsCount_ = 0;
+}
+
+static void gc_mark_interior_ptr(uintptr_t ptr) noexcept
+{
+    /* Pointers to the stack or to statics need no marking. */
+    if (ptr > uintptr_t(pHeapRegionStart_) && ptr < uintptr_t(pHeapEnd_))
+    {
+        if (gcInteriorPtrsCount_ == gcInteriorBatchSize_)
+            gc_mark_interior_ptrs();
+        gcInteriorPtrs_[gcInteriorPtrsCount_++] = ptr;
+    }
+}
+
+static void gc_mark_refs(const uint8_t *base, const uint32_t *refs, uint32_t refs_count) noexcept
+{
+    for (uint32_t i = 0; i < refs_count; i++)
+    {
+        if (refs[i] & gc_interior_ref_bit)
+        {
+            gc_mark_interior_ptr(*reinterpret_cast<const uintptr_t *>(base + (refs[i] & ~gc_interior_ref_bit)));
+        }
+        else
+        {
+            gc_mark_object(*reinterpret_cast<Object *const *>(base + refs[i]));
+        }
+    }
+}
+
+static void gc_scan_object(Object *obj) noexcept
+{
+    auto vtable = gc_obj_ref<Object>(obj).header().vtable_;
+    if (!vtable->GCRefsCount)
+        return;
+
+    auto base = reinterpret_cast<const uint8_t *>(obj);
+    if (vtable->ElementSize)
+    {
+        auto array = reinterpret_cast<const RawSzArrayData *>(obj);
+        auto elements = reinterpret_cast<const uint8_t *>(&array->Data);
+        for (intptr_t i = 0; i < (intptr_t)array->Count; i++)
+            gc_mark_refs(elements + i * vtable->ElementSize, vtable->GCRefs, vtable->GCRefsCount);
+    }
+    else
+    {
+        gc_mark_refs(base, vtable->GCRefs, vtable->GCRefsCount);
+    }
+}
+
+static void gc_drain_mark_stack() noexcept
+{
+    if (gcInteriorPtrsCount_)
+        gc_mark_interior_ptrs();
+    while (gcMarkStackTop_)
+        gc_scan_object(gcMarkStack_[--gcMarkStackTop_]);
+}
+
+/* Greys the objects referenced by statics and shadow stacks, a stop-the-world collection traces them right away. */
+static void gc_mark_roots(bool drain) noexcept
+{
+    for (auto root = gcStaticRoots_; root; root = root->next_)
+    {
+        gc_mark_refs(reinterpret_cast<const uint8_t *>(root->root_.base_), root->root_.refs_, root->root_.refs_count_);
+        if (drain)
+            gc_drain_mark_stack();
+    }
+
+    for (auto thread = gcThreads_; thread; thread = thread->next_)
+    {
+        for (auto frame = thread->frames_; frame; frame = frame->prev_)
+        {
+            for (uint32_t i = 0; i < frame->roots_count_; i++)
+            {
+                auto &root = frame->roots_[i];
+                gc_mark_refs(reinterpret_cast<const uint8_t *>(root.base_), root.refs_, root.refs_count_);
+            }
+
+            if (drain)
+                gc_drain_mark_stack();
+        }
+    }
+
+    if (gcInteriorPtrsCount_)
+        gc_mark_interior_ptrs();
+}
+
+/* Objects dropped from a full mark stack are marked but not scanned yet. */
+static void gc_mark_overflowed() noexcept
+{
+    while (gcMarkStackOverflow_)
+    {
+        gcMarkStackOverflow_ = false;
+        for (auto block = pHeapRegionStart_; block < pHeapEnd_;)
+        {
+            if (block->BlockSize & blockAllocatedBit_)
+            {
+                gc_for_each_object(block, [](object_header &header, size_t) {
+                    if (header.attributes_ & OBJ_ATTR_MARKED)
+                    {
+                        gc_scan_object(gc_object_of(header));
+                        gc_drain_mark_stack();
+                    }
+                });
+            }
+
+            block = reinterpret_cast<BlockLink_t *>(uintptr_t(block) + (block->BlockSize & ~blockAllocatedBit_));
+        }
+    }
+}
+
+/* Old objects stored to since the last collection may be the only references to young objects. */
+static void gc_mark_dirty_cards() noexcept
+{
+    for (auto block = pHeapRegionStart_; block < pHeapEnd_;)
+    {
+        auto blockSize = block->BlockSize & ~blockAllocatedBit_;
+        if ((block->BlockSize & blockAllocatedBit_) && gc_cards_dirty(block, blockSize))
+        {
+            gc_for_each_object(block, [](object_header &header, size_t size) {
+                if ((header.attributes_ & OBJ_ATTR_OLD) && gc_cards_dirty(&header, size))
+                {
+                    gc_scan_object(gc_object_of(header));
+                    gc_drain_mark_stack();
+                }
+            });
+        }
+
+        block = reinterpret_cast<BlockLink_t *>(uintptr_t(block) + blockSize);
+    }
+}
+
+/*
+* Marked objects survive, old objects also survive minor collections. The
+* survivors are promoted to the old generation.
+*/
+static bool gc_sweep_object(object_header &header, size_t size) noexcept
+{
+    if (!(header.attributes_ & OBJ_ATTR_MARKED) && !(gcMinorCollection_ && (header.attributes_ & OBJ_ATTR_OLD)))
+        return false;
+
+    if (!(header.attributes_ & OBJ_ATTR_OLD))
+        gcPromotedBytes_ += size;
+    header.attributes_ = object_attributes((header.attributes_ & ~OBJ_ATTR_MARKED) | OBJ_ATTR_OLD);
+    return true;
+}
+
+/*
+* Frees the unmarked objects of a slab page and rebuilds its free slots.
+* Returns true when no live object is left in the page.
+*/
+static bool gc_sweep_slab_page(BlockLink_t *block) noexcept
+{
+    auto page = slab_page_of(block);
+    auto slotSize = slabClassSizes_[page->SizeClass];
+    auto slot = slab_first_slot(page) + slab_slots_count(page) * slotSize;
+    SlabSlot_t *pFreeSlots = nullptr;
+    uint32_t usedSlots = 0;
+
+    for (size_t i = 0; i < slab_slots_count(page); i++)
+    {
+        slot -= slotSize;
+        auto &header = *reinterpret_cast<object_header *>(slot);
+        if (header.vtable_)
+        {
+            if (gc_sweep_object(header, slotSize))
+            {
+                usedSlots++;
+                continue;
+            }
+
+            header.vtable_ = nullptr;
+        }
+
+        auto freeSlot = reinterpret_cast<SlabSlot_t *>(slot);
+        freeSlot->pNextFreeSlot = pFreeSlots;
+        pFreeSlots = freeSlot;
+    }
+
+    page->pFreeSlots = pFreeSlots;
+    page->UsedSlots = usedSlots;
+    if (!usedSlots)
+        return true;
+
+    if (pFreeSlots)
+    {
+        page->pNextPage = slabPartialPages_[page->SizeClass];
+        slabPartialPages_[page->SizeClass] = page;
+    }
+
+    return false;
+}
+
+/*
+* Merges the unmarked objects of a chunk into zeroed holes. Returns true when
+* no live object is left in the chunk.
+*/
+static bool gc_sweep_tlab_chunk(BlockLink_t *block) noexcept
+{
+    auto chunk = tlab_chunk_of(block);
+    auto end = tlab_chunk_end(chunk);
+    gc_tlab_unit *pHole = nullptr;
+    bool hasHoles = false, hasObjects = false;
+
+    for (auto unit = tlab_first_unit(chunk); unit < end;)
+    {
+        auto pUnit = reinterpret_cast<gc_tlab_unit *>(unit);
+        auto unitSize = pUnit->size_ & ~tlabHoleBit_;
+        bool isHole = pUnit->size_ & tlabHoleBit_;
+        unit += unitSize;
+
+        if (!isHole)
+        {
+            auto &header = *reinterpret_cast<object_header *>(pUnit + 1);
+            if (gc_sweep_object(header, unitSize - sizeof(gc_tlab_unit)))
+            {
+                hasObjects = true;
+                pHole = nullptr;
+                continue;
+            }
+        }
+
+        /* Only the size of a hole is not zero. */
+        std::memset(pUnit, 0, isHole ? sizeof(gc_tlab_unit) : unitSize);
+        if (pHole)
+        {
+            pHole->size_ += unitSize;
+        }
+        else
+        {
+            pHole = pUnit;
+            pHole->size_ = unitSize | tlabHoleBit_;
+            hasHoles = true;
+        }
+    }
+
+    if (!hasObjects)
+        return true;
+
+    if (hasHoles)
+    {
+        chunk->pNextChunk = tlabRecyclableChunks_;
+        tlabRecyclableChunks_ = chunk;
+    }
+
+    return false;
+}
+
+/*
+* Walks all blocks in address order, frees unmarked objects and rebuilds the
+* free list in the same pass, so a collection is linear in the number of blocks.
+*/
+static void gc_sweep() noexcept
+{
+    BlockLink_t *pPreviousBlock = nullptr, *pFreeRun = nullptr;
+    size_t freeBytes = 0;
+
+    for (auto &pages : slabPartialPages_)
+        pages = nullptr;
+    tlabRecyclableChunks_ = nullptr;
+
+    prvBeginFreeListRebuild();
+    for (auto block = pHeapRegionStart_; block < pHeapEnd_;)
+    {
+        auto blockSize = block->BlockSize & ~blockAllocatedBit_;
+        auto next = reinterpret_cast<BlockLink_t *>(uintptr_t(block) + blockSize);
+        bool isFree = !(block->BlockSize & blockAllocatedBit_);
+
+        if (!isFree && block->pNextFreeBlock == pManagedBlockTag_)
+        {
+            isFree = !gc_sweep_object(gc_header_of(block), blockSize - heapStructSize_);
+        }
+        else if (!isFree && block->pNextFreeBlock == pSlabBlockTag_)
+        {
+            isFree = gc_sweep_slab_page(block);
+        }
+        else if (!isFree && block->pNextFreeBlock == pTlabBlockTag_)
+        {
+            isFree = gc_sweep_tlab_chunk(block);
+        }
+
+        if (isFree)
+        {
+            freeBytes += blockSize;
+            if (pFreeRun)
+            {
+                /* Merge with the adjacent free block in front of it. */
+                pFreeRun->BlockSize += blockSize;
+                block = next;
+                continue;
+            }
+
+            pFreeRun = block;
+            pFreeRun->BlockSize = blockSize;
+        }
+        else if (pFreeRun)
+        {
+            prvAppendFreeRun(pFreeRun);
+            pFreeRun = nullptr;
+        }
+
+        prvLinkPhysicalBlock(block, pPreviousBlock);
+        pPreviousBlock = block;
+        block = next;
+    }
+
+    if (pFreeRun)
+        prvAppendFreeRun(pFreeRun);
+    prvEndFreeListRebuild(pPreviousBlock);
+    freeBytesRemaining_ = freeBytes;
+}
+
+static void gc_retire_buffers() noexcept
+{
+    /* Allocation buffers are handed out again from the rebuilt chunks. */
+    for (auto thread = gcThreads_; thread; thread = thread->next_)
+    {
+        tlab_retire(*thread);
+        thread->alloc_ptr_ = thread->alloc_limit_ = thread->alloc_end_ = thread->alloc_counted_ = nullptr;
+    }
+}
+
+static void gc_record_pause(uint64_t start) noexcept
+{
+    auto pause = uint32_t(gc_clock_us() - start);
+    if (pause > gcLongestPauseUs_)
+        gcLongestPauseUs_ = pause;
+}
+
+/* Sweeps once marking is complete, ending the collection. */
+static void gc_finish_collection() noexcept
+{
+    gc_retire_buffers();
+    gc_mark_overflowed();
+
+    /* Every survivor is old now, so no old object refers to a young one. */
+    if (gc_cards.cards_)
+        std::memset(gc_cards.cards_, 0, gcCardsCount_);
+
+    gc_sweep();
+    gcAllocatedBytes_ = 0;
+    if (!gcMinorCollection_)
+        gcPromotedBytes_ = 0;
+    gcMinorCollection_ = false;
+    gc_marking = false;
+    gc_alloc_attributes = OBJ_ATTR_NONE;
+}
+
+static void gc_run_collection(bool minor) noexcept
+{
+#ifdef WIN32
+    InitializeHeap();
+#endif
+
+    auto start = gc_clock_us();
+    //vTaskSuspendAll();
+    {
+        if (gc_marking)
+        {
+            /* Complete the incremental marking in progress. */
+            gc_drain_mark_stack();
+        }
+        else
+        {
+            gc_retire_buffers();
+            gcMinorCollection_ = minor && gc_cards.cards_;
+            if (gcMinorCollection_)
+                gc_mark_dirty_cards();
+            gc_mark_roots(true);
+        }
+
+        gc_finish_collection();
+    }
+    //(void)xTaskResumeAll();
+    gc_record_pause(start);
+}
+
+/*
+* Starts an incremental full collection. The roots are greyed in this pause,
+* objects allocated from now on are born marked and the write barrier shades
+* the references it overwrites, so everything reachable at this point is found.
+*/
+static void gc_start_marking() noexcept
+{
+    auto start = gc_clock_us();
+    gc_marking = true;
+    gc_alloc_attributes = OBJ_ATTR_MARKED;
+    gc_mark_roots(false);
+    gc_record_pause(start);
+}
+
+/* Scans grey objects until the pause budget is used up, the collection finishes once none is left. */
+static void gc_mark_step() noexcept
+{
+    auto start = gc_clock_us();
+    for (size_t batch = 0; gcMarkStackTop_ && batch < gcMarkStepBatches_; batch++)
+    {
+        for (size_t i = 0; gcMarkStackTop_ && i < gcMarkBatchObjects_; i++)
+            gc_scan_object(gcMarkStack_[--gcMarkStackTop_]);
+        if (gc_clock_us() - start >= gcMaxPauseUs_)
+            break;
+    }
+
+    if (!gcMarkStackTop_)
+        gc_finish_collection();
+    gc_record_pause(start);
+}
+
+void natsu::gc_collect()
+{
+    gc_unsafe_region unsafe;
+    gc_run_collection(false);
+}
+
+/*
+* Allocation samples are kept in a ring buffer, the oldest ones are
+* overwritten. The call site is an address in the code gc_alloc was
+* inlined in.
+*/
+struct gc_alloc_sample
+{
+    uintptr_t call_site;
+    const clr_vtable *vtable;
+    uint32_t size;
+};
+
+static constexpr size_t gcSampleCount_ = 256;
+static gc_alloc_sample gcSamples_[gcSampleCount_];
+static size_t gcSamplesTaken_ = 0;
+static std::atomic_flag gcSamplesLock_ = ATOMIC_FLAG_INIT;
+static std::atomic<uint32_t> gcSampleInterval_ = 0;
+
+static int64_t gc_sample_countdown() noexcept
+{
+    auto interval = gcSampleInterval_.load(std::memory_order_relaxed);
+    return interval ? interval : INT64_MAX;
+}
+
+#if _MSC_VER
+uintptr_t natsu::gc_return_address() noexcept
+{
+    return uintptr_t(_ReturnAddress());
+}
+#endif
+
+void natsu::gc_sample_alloc(const clr_vtable &vtable, size_t size, uintptr_t call_site)
+{
+    // A new thread's countdown starts at zero, its first allocation only arms it
+    if (gcSampleInterval_.load(std::memory_order_relaxed))
+    {
+        while (gcSamplesLock_.test_and_set(std::memory_order_acquire))
+            ;
+        gcSamples_[gcSamplesTaken_++ % gcSampleCount_] = { call_site, &vtable, uint32_t(size) };
+        gcSamplesLock_.clear(std::memory_order_release);
+    }
+
+    gc_current_thread().sample_countdown_.store(gc_sample_countdown(), std::memory_order_relaxed);
+}
+
+void natsu::gc_shade_refs(const void *base, const uint32_t *refs, uint32_t refs_count) noexcept
+{
+    gc_unsafe_region unsafe;
+    gc_mark_refs(reinterpret_cast<const uint8_t *>(base), refs, refs_count);
+    if (gcInteriorPtrsCount_)
+        gc_mark_interior_ptrs();
+}
+
+/* Interior pointer lookup only finds allocated objects, so a word that merely looks like a pointer keeps no free memory alive. */
+void natsu::gc_shade_range(const void *begin, size_t size) noexcept
+{
+    gc_unsafe_region unsafe;
+    auto words = reinterpret_cast<const uintptr_t *>(begin);
+    for (size_t i = 0; i < size / sizeof(uintptr_t); i++)
+        gc_mark_interior_ptr(words[i]);
+    if (gcInteriorPtrsCount_)
+        gc_mark_interior_ptrs();
+}
+
+static uint8_t *gc_heap_alloc(size_t size) noexcept
+{
+    if (size <= slabMaxSize_)
+        return slab_alloc(size);
+
+    auto mem_ptr = reinterpret_cast<uint8_t *>(HeapAlloc(size));
+    if (mem_ptr)
+        reinterpret_cast<BlockLink_t *>(mem_ptr - heapStructSize_)->pNextFreeBlock = pManagedBlockTag_;
+    return mem_ptr;
+}
+
+gc_obj_ref<Object> natsu::gc_alloc_slow(const clr_vtable &vtable, size_t size)
+{
+    auto totalSize = size + sizeof(object_header);
+    if (!gcCardsInitialized_)
+    {
+#ifdef WIN32
+        InitializeHeap();
+#endif
+        gc_init_cards();
+    }
+
+    if (gc_marking)
+    {
+        gc_mark_step();
+    }
+    else if (gcAllocatedBytes_ >= gcAllocationBudget_)
+    {
+        if (gcPromotedBytes_ < gcPromotionBudget_)
+            gc_run_collection(true);
+        else if (gcMaxPauseUs_)
+            gc_start_marking();
+        else
+            gc_run_collection(false);
+    }
+
+    auto unitSize = gc_tlab_unit_size(size);
+    if (unitSize <= tlabMaxUnitSize_)
+    {
+        auto &thread = gc_current_thread();
+        if (!tlab_refill(thread, unitSize))
+        {
+            gc_collect();
+            if (!tlab_refill(thread, unitSize))
+                throw make_exception(make_object<OutOfMemoryException>());
+        }
+
+        return tlab_alloc(thread, vtable, unitSize);
+    }
+
+    auto mem_ptr = gc_heap_alloc(totalSize);
+    if (!mem_ptr)
+    {
+        gc_collect();
+        mem_ptr = gc_heap_alloc(totalSize);
+        if (!mem_ptr)
+            throw make_exception(make_object<OutOfMemoryException>());
+    }
+
+    gcAllocatedBytes_ += totalSize;
+    gc_count_alloc(vtable, size);
+    std::memset(mem_ptr, 0, totalSize);
+    gc_obj_ref<Object> ptr(reinterpret_cast<Object *>(mem_ptr + sizeof(object_header)));
+    new (&ptr.header()) object_header(gc_alloc_attributes, &vtable);
+    return ptr;
+}
+
+void GC::_s_Collect()
+{
+    gc_collect();
+}
+
+int32_t MemoryManager::_s_GetUsedMemorySize()
+{
+#if _WIN32
+    return 6 * 1024 * 1024 - freeBytesRemaining_;
+#else
+    return size_t(&_heap_end[0] - &_heap_start[0]) - freeBytesRemaining_;
+#endif
+}
+
+int32_t MemoryManager::_s_GetFreeMemorySize()
+{
+    return freeBytesRemaining_;
+}
+
+int32_t MemoryManager::_s_GetMinimumEverFreeMemorySize()
+{
+    return minimumEverFreeBytesRemaining_;
+}
+
+int32_t MemoryManager::_s_GetLargestFreeBlockSize()
+{
+    return prvGetLargestFreeBlockSize();
+}
+
+bool MemoryManager::_s_GetAllocationStatistics(int32_t index, gc_ref<IntPtr> type, gc_ref<int32_t> count, gc_ref<int64_t> bytes)
+{
+    if (index < 0)
+        return false;
+
+    {
+        // Other threads' buffers are counted when they retire them
+        gc_unsafe_region unsafe;
+        tlab_count(gc_current_thread());
+    }
+
+    auto stats = gcAllocatedTypes_.load(std::memory_order_acquire);
+    for (; stats && index; index--)
+        stats = stats->next;
+    if (!stats)
+        return false;
+
+    *type = IntPtr(intptr_t(stats->vtable));
+    *count = int32_t(stats->count.load(std::memory_order_relaxed));
+    *bytes = int64_t(stats->bytes.load(std::memory_order_relaxed));
+    return true;
+}
+
+int32_t MemoryManager::_s_GetAllocationSampleInterval()
+{
+    return gcSampleInterval_.load(std::memory_order_relaxed);
+}
+
+void MemoryManager::_s_SetAllocationSampleInterval(int32_t bytes)
+{
+    gcSampleInterval_.store(bytes > 0 ? uint32_t(bytes) : 0, std::memory_order_relaxed);
+    while (gcSamplesLock_.test_and_set(std::memory_order_acquire))
+        ;
+    gcSamplesTaken_ = 0;
+    gcSamplesLock_.clear(std::memory_order_release);
+
+    while (gcThreadsLock_.test_and_set(std::memory_order_acquire))
+        ;
+    for (auto thread = gcThreads_; thread; thread = thread->next_)
+        thread->sample_countdown_.store(gc_sample_countdown(), std::memory_order_relaxed);
+    gcThreadsLock_.clear(std::memory_order_release);
+}
+
+bool MemoryManager::_s_GetAllocationSample(int32_t index, gc_ref<IntPtr> callSite, gc_ref<IntPtr> type, gc_ref<int32_t> size)
+{
+    while (gcSamplesLock_.test_and_set(std::memory_order_acquire))
+        ;
+    auto count = gcSamplesTaken_ < gcSampleCount_ ? gcSamplesTaken_ : gcSampleCount_;
+    auto found = index >= 0 && size_t(index) < count;
+    gc_alloc_sample sample {};
+    if (found)
+        sample = gcSamples_[(gcSamplesTaken_ - count + index) % gcSampleCount_];
+    gcSamplesLock_.clear(std::memory_order_release);
+    if (!found)
+        return false;
+
+    *callSite = IntPtr(intptr_t(sample.call_site));
+    *type = IntPtr(intptr_t(sample.vtable));
+    *size = int32_t(sample.size);
+    return true;
+}
+
+int32_t MemoryManager::_s_GetGCMaxPause()
+{
+    return gcMaxPauseUs_;
+}
+
+void MemoryManager::_s_SetGCMaxPause(int32_t microseconds)
+{
+    gcMaxPauseUs_ = microseconds > 0 ? uint32_t(microseconds) : 0;
+}
+
+int32_t MemoryManager::_s_GetGCLongestPause()
+{
+    return gcLongestPauseUs_;
+}
+
+void MemoryManager::_s_StepGC()
+{
+    gc_unsafe_region unsafe;
+    if (gc_marking)
+        gc_mark_step();
 }
@@ -128,4 +128,84 @@ double Math::_s_FMod(double x, double y)
 double Math::_s_ModF(double x, gc_ptr<double> y)
 {
     return fmod(x, *y);
+}
+
+float MathF::_s_Abs(float x)
+{
+    return fabsf(x);
+}
+
+float MathF::_s_Acos(float x)
+{
+    return acosf(x);
+}
+
+float MathF::_s_Asin(float x)
+{
+    return asinf(x);
+}
+
+float MathF::_s_Atan(float x)
+{
+    return atanf(x);
+}
+
+float MathF::_s_Atan2(float y, float x)
+{
+    return atan2f(y, x);
+}
+
+float MathF::_s_Ceiling(float x)
+{
+    return ceilf(x);
+}
+
+float MathF::_s_Cos(float x)
+{
+    return cosf(x);
+}
+
+float MathF::_s_Exp(float x)
+{
+    return expf(x);
+}
+
+float MathF::_s_Floor(float x)
+{
+    return floorf(x);
+}
+
+float MathF::_s_Log(float x)
+{
+    return logf(x);
+}
+
+float MathF::_s_Log10(float x)
+{
+    return log10f(x);
+}
+
+float MathF::_s_Pow(float x, float y)
+{
+    return powf(x, y);
+}
+
+float MathF::_s_Sin(float x)
+{
+    return sinf(x);
+}
+
+float MathF::_s_Sqrt(float x)
+{
+    return sqrtf(x);
+}
+
+float MathF::_s_Tan(float x)
+{
+    return tanf(x);
+}
+
+float MathF::_s_Tanh(float x)
+{
+    return tanhf(x);
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "Chino.Kernel.h"
+#include "System.Private.CoreLib.h"
+#include <string>
+
+using namespace natsu;
+using namespace Chino_Core::Chino::Diagnostics;
+
+#if NATSU_PROFILE
+namespace
+{
+std::atomic<profile_counter *> profile_counters_;
+}
+
+profile_counter::profile_counter(const char *name) noexcept
+    : name_(name), count_(0), next_(profile_counters_.load(std::memory_order_relaxed))
+{
+    while (!profile_counters_.compare_exchange_weak(next_, this))
+        ;
+}
+
+// Lines are prefixed so the compiler can pick the profile out of a log with other output
+void natsu::dump_profile()
+{
+    for (auto counter = profile_counters_.load(); counter; counter = counter->next_)
+    {
+        std::u16string line = u"natsu-profile: ";
+        for (auto c : std::to_string(counter->count_.load()))
+            line.push_back(c);
+        line.push_back(u' ');
+        for (auto name = counter->name_; *name; name++)
+            line.push_back((uint8_t)*name);
+        line.push_back(u'\n');
+        Chino_Kernel::Chino::Kernel::KernelDebug::_s_Write(load_string(line));
+    }
+}
+#endif
+
+// The shell never returns from Main, so the profile is dumped on request
+bool CodeProfile::_s_Dump()
+{
+#if NATSU_PROFILE
+    dump_profile();
+    return true;
+#else
+    return false;
+#endif
+}
@@ -46,6 +46,11 @@ void natsu::throw_overflow_exception()
     throw make_exception(make_object<OverflowException>());
 }
 
+void natsu::throw_divide_by_zero_exception()
+{
+    throw make_exception(make_object<DivideByZeroException>());
+}
+
 void natsu::pure_call()
 {
     throw std::runtime_error("pure call");
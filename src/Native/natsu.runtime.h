@@ -1,11 +1,13 @@
 // natsu clr runtime
 #pragma once
 #include "natsu.typedef.h"
+#include "natsu.simd.h"
 #include <cmath>
 #include <limits>
 #include <optional>
 #include <utility>
 #if _MSC_VER
+#include <intrin.h>
 #include <malloc.h>
 #else
 #include <alloca.h>
@@ -125,26 +127,107 @@ auto &vtable(gc_obj_ref<> obj) noexcept
     return *static_cast<const typename T::VTable *>(obj.header().vtable_);
 }
 
-gc_obj_ref<::System_Private_CoreLib::System::Object> gc_alloc(const clr_vtable &vtable, size_t size);
+gc_obj_ref<::System_Private_CoreLib::System::Object> gc_alloc_slow(const clr_vtable &vtable, size_t size);
+void gc_collect();
+void gc_shade_refs(const void *base, const uint32_t *refs, uint32_t refs_count) noexcept;
+// Shades a range whose layout is unknown, every word pointing into the heap is taken as a reference
+void gc_shade_range(const void *begin, size_t size) noexcept;
+
+// Set while an incremental collection is marking, new objects are allocated marked then
+inline bool gc_marking = false;
+inline object_attributes gc_alloc_attributes = OBJ_ATTR_NONE;
+
+// Allocation sampling, the allocating code is recorded when the thread's countdown of bytes runs out.
+// The allocation path is always inlined, so the address of the code it expands in lies in the allocating method.
+void gc_sample_alloc(const clr_vtable &vtable, size_t size, uintptr_t call_site);
+
+#if _MSC_VER
+// Returns the address its call returns to, MSVC has no way to take the address of the current code
+__declspec(noinline) uintptr_t gc_return_address() noexcept;
+#define NATSU_CODE_ADDRESS() ::natsu::gc_return_address()
+#else
+#define NATSU_CODE_ADDRESS() ({ __label__ natsu_code_address; natsu_code_address: reinterpret_cast<uintptr_t>(&&natsu_code_address); })
+#endif
+
+NATSU_FORCEINLINE gc_obj_ref<::System_Private_CoreLib::System::Object> gc_alloc(const clr_vtable &vtable, size_t size)
+{
+    gc_unsafe_region unsafe;
+    auto &thread = gc_current_thread();
+    auto countdown = thread.sample_countdown_.load(std::memory_order_relaxed) - int64_t(size);
+    thread.sample_countdown_.store(countdown, std::memory_order_relaxed);
+    if (countdown < 0)
+        gc_sample_alloc(vtable, size, NATSU_CODE_ADDRESS());
+
+    // Bump the current thread's allocation buffer, its free space is already zeroed
+    auto unit_size = gc_tlab_unit_size(size);
+    if (unit_size <= gc_tlab_max_unit_size && size_t(thread.alloc_limit_ - thread.alloc_ptr_) >= unit_size)
+    {
+        auto unit = reinterpret_cast<gc_tlab_unit *>(thread.alloc_ptr_);
+        thread.alloc_ptr_ += unit_size;
+        unit->size_ = unit_size;
+        auto header = new (unit + 1) object_header(gc_alloc_attributes, &vtable);
+        return gc_obj_ref<::System_Private_CoreLib::System::Object>(reinterpret_cast<::System_Private_CoreLib::System::Object *>(header + 1));
+    }
+
+    return gc_alloc_slow(vtable, size);
+}
+
+// Card table over the managed heap, minor collections only scan the old objects in dirty cards
+struct gc_card_table
+{
+    static constexpr size_t card_shift = 9;
+
+    uintptr_t heap_base_;
+    size_t heap_size_;
+    uint8_t *cards_;
+
+    void mark(const void *begin, size_t size) noexcept
+    {
+        auto offset = uintptr_t(begin) - heap_base_;
+        if (offset < heap_size_)
+        {
+            auto last = (offset + size - 1) >> card_shift;
+            for (auto card = offset >> card_shift; card <= last; card++)
+                cards_[card] = 1;
+        }
+    }
+};
+
+inline gc_card_table gc_cards;
+
+// Write barrier, returns the slot a reference is about to be stored to.
+// While marking, the references it still holds are shaded to keep the snapshot at the beginning.
+template <class T>
+T &gc_barrier(T &slot) noexcept
+{
+    if constexpr (gc_refs_holder<T>::value.size() != 0)
+    {
+        if (gc_marking)
+            gc_shade_refs(&slot, gc_refs_holder<T>::value.data(), (uint32_t)gc_refs_holder<T>::value.size());
+    }
+
+    gc_cards.mark(&slot, sizeof(T));
+    return slot;
+}
 
 template <class T>
-gc_obj_ref<T> gc_new(size_t size)
+NATSU_FORCEINLINE gc_obj_ref<T> gc_new(size_t size)
 {
     auto obj = gc_alloc(vtable_holder<typename to_clr_type_t<T>::VTable>::get(), size);
     return obj.template cast<T>();
 }
 
 template <class T>
-gc_obj_ref<T> gc_new()
+NATSU_FORCEINLINE gc_obj_ref<T> gc_new()
 {
     return gc_new<T>(sizeof(T));
 }
 
 template <class T>
-gc_obj_ref<::System_Private_CoreLib::System::SZArray_1<T>> gc_new_array(int32_t length)
+NATSU_FORCEINLINE gc_obj_ref<::System_Private_CoreLib::System::SZArray_1<T>> gc_new_array(int32_t length)
 {
     using obj_t = ::System_Private_CoreLib::System::SZArray_1<T>;
-    auto size = sizeof(obj_t) + (size_t)length * sizeof(T);
+    auto size = sizeof(obj_t) + (size_t)length * sizeof(variable_type_t<T>);
     auto obj = gc_new<obj_t>(size);
     obj->Length = length;
     return obj;
@@ -192,7 +275,7 @@ clr_exception make_exception(gc_obj_ref<T> exception)
 }
 
 template <class T, class... TArgs>
-[[noreturn]] void throw_exception(TArgs &&... args)
+[[noreturn]] NATSU_COLD void throw_exception(TArgs &&... args)
 {
     throw make_exception(make_object<T>(std::forward<TArgs>(args)...));
 }
@@ -506,6 +589,23 @@ namespace ops
         }
     }
 
+    template <class T, class... TArgs>
+    auto newobj_stack(stack_object<T> &storage, TArgs... args)
+    {
+        if constexpr (sizeof(T) <= stack_object_max_size)
+        {
+            std::memset(&storage, 0, sizeof(storage));
+            new (storage.header_) object_header(OBJ_ATTR_NONE, &vtable_holder<typename T::VTable>::get());
+            auto value = gc_obj_ref<T>(reinterpret_cast<T *>(storage.value_));
+            value->_ctor(value, std::forward<TArgs>(args)...);
+            return value;
+        }
+        else
+        {
+            return newobj<T>(std::forward<TArgs>(args)...);
+        }
+    }
+
     template <class TFrom>
     auto box(TFrom value) noexcept
     {
@@ -524,18 +624,153 @@ namespace ops
         return stack::details::ref_impl<T>()(value);
     }
 
+    // The references being cleared go through the write barrier, like stores do
     template <class TFrom>
     void initobj(gc_ref<TFrom> addr) noexcept
     {
+        if constexpr (gc_refs_holder<TFrom>::value.size() != 0)
+            gc_barrier(*reinterpret_cast<TFrom *>(addr.ptr_));
         std::memset((void *)addr.ptr_, 0, sizeof(TFrom));
     }
 
     template <class TFrom>
     void initobj(intptr_t addr) noexcept
     {
+        if constexpr (gc_refs_holder<TFrom>::value.size() != 0)
+            gc_barrier(*reinterpret_cast<TFrom *>(addr));
         std::memset((void *)addr, 0, sizeof(TFrom));
     }
 
+    // System.Numerics.BitOperations, the compiler calls these instead of the software fallbacks
+    // __popcnt faults on CPUs without POPCNT, so MSVC counts bits in parallel within the word instead
+    inline int32_t popcount(uint32_t value) noexcept
+    {
+#if _MSC_VER
+        value = value - ((value >> 1) & 0x55555555);
+        value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+        return int32_t((((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+#else
+        return __builtin_popcount(value);
+#endif
+    }
+
+    inline int32_t popcount(uint64_t value) noexcept
+    {
+#if _MSC_VER
+        return popcount(uint32_t(value)) + popcount(uint32_t(value >> 32));
+#else
+        return __builtin_popcountll(value);
+#endif
+    }
+
+    inline int32_t lzcnt(uint32_t value) noexcept
+    {
+#if _MSC_VER
+        unsigned long index;
+        return _BitScanReverse(&index, value) ? 31 - index : 32;
+#else
+        return value ? __builtin_clz(value) : 32;
+#endif
+    }
+
+    inline int32_t lzcnt(uint64_t value) noexcept
+    {
+#if _MSC_VER
+#ifdef _WIN64
+        unsigned long index;
+        return _BitScanReverse64(&index, value) ? 63 - index : 64;
+#else
+        auto high = uint32_t(value >> 32);
+        return high ? lzcnt(high) : 32 + lzcnt(uint32_t(value));
+#endif
+#else
+        return value ? __builtin_clzll(value) : 64;
+#endif
+    }
+
+    inline int32_t tzcnt(uint32_t value) noexcept
+    {
+#if _MSC_VER
+        unsigned long index;
+        return _BitScanForward(&index, value) ? index : 32;
+#else
+        return value ? __builtin_ctz(value) : 32;
+#endif
+    }
+
+    inline int32_t tzcnt(uint64_t value) noexcept
+    {
+#if _MSC_VER
+#ifdef _WIN64
+        unsigned long index;
+        return _BitScanForward64(&index, value) ? index : 64;
+#else
+        auto low = uint32_t(value);
+        return low ? tzcnt(low) : 32 + tzcnt(uint32_t(value >> 32));
+#endif
+#else
+        return value ? __builtin_ctzll(value) : 64;
+#endif
+    }
+
+    // Log2(0) is 0 by convention
+    inline int32_t log2(uint32_t value) noexcept
+    {
+        return 31 ^ lzcnt(value | 1);
+    }
+
+    inline int32_t log2(uint64_t value) noexcept
+    {
+        return 63 ^ lzcnt(value | 1);
+    }
+
+    inline uint32_t rotl(uint32_t value, int32_t offset) noexcept
+    {
+        return (value << (offset & 31)) | (value >> (-offset & 31));
+    }
+
+    inline uint64_t rotl(uint64_t value, int32_t offset) noexcept
+    {
+        return (value << (offset & 63)) | (value >> (-offset & 63));
+    }
+
+    inline uint32_t rotr(uint32_t value, int32_t offset) noexcept
+    {
+        return (value >> (offset & 31)) | (value << (-offset & 31));
+    }
+
+    inline uint64_t rotr(uint64_t value, int32_t offset) noexcept
+    {
+        return (value >> (offset & 63)) | (value << (-offset & 63));
+    }
+
+    // Internal.Runtime.CompilerServices.Unsafe, lowered to plain pointer arithmetic
+    template <class T, class TRef>
+    gc_ref<T> ref_add(TRef source, intptr_t element_offset) noexcept
+    {
+        return *(reinterpret_cast<T *>(source.ptr_) + element_offset);
+    }
+
+    template <class T, class TRef>
+    gc_ref<T> ref_add_byte_offset(TRef source, intptr_t byte_offset) noexcept
+    {
+        return *reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(source.ptr_) + byte_offset);
+    }
+
+    template <class TTo, class TRef>
+    gc_ref<TTo> ref_as(TRef source) noexcept
+    {
+        return *reinterpret_cast<TTo *>(source.ptr_);
+    }
+
+    template <class T, class TPtr>
+    T read_unaligned(TPtr source) noexcept
+    {
+        T value;
+        std::memcpy(&value, source.ptr_, sizeof(T));
+        return value;
+    }
+
     // ECMA-335 III.4.3
     template <class TTo, class TFrom>
     auto castclass(const gc_obj_ref<TFrom> &obj) noexcept
@@ -564,6 +799,14 @@ namespace ops
         return stack::details::unbox_any_impl<TFrom, TTo>()(obj);
     }
 
+    // ECMA-335 III.4.2
+    template <class T>
+    gc_obj_ref<T> check_this(gc_obj_ref<T> obj)
+    {
+        check_null_obj_ref(obj);
+        return obj;
+    }
+
     template <class T>
     ::System_Private_CoreLib::System::IntPtr ldftn(T func)
     {
@@ -606,6 +849,37 @@ namespace ops
         *reinterpret_cast<TTo *>(address.get()) = value;
     }
 
+    // Addresses the compiler proved non-null
+    template <class T>
+    T ldind_unchecked(uintptr_t address)
+    {
+        return *reinterpret_cast<const T *>(address);
+    }
+
+    template <class TTo, class TFrom>
+    TTo ldind_unchecked(const gc_ptr<TFrom> &address)
+    {
+        return *reinterpret_cast<const TTo *>(address.get());
+    }
+
+    template <class TTo, class TFrom>
+    TTo ldind_unchecked(const gc_ref<TFrom> &address)
+    {
+        return *reinterpret_cast<const TTo *>(address.get());
+    }
+
+    template <class TTo, class TFrom>
+    void stind_unchecked(gc_ptr<TFrom> &address, TTo value)
+    {
+        *reinterpret_cast<TTo *>(address.get()) = value;
+    }
+
+    template <class TTo, class TFrom>
+    void stind_unchecked(gc_ref<TFrom> &address, TTo value)
+    {
+        *reinterpret_cast<TTo *>(address.get()) = value;
+    }
+
     template <class T>
     ::System_Private_CoreLib::System::RuntimeTypeHandle ldtoken_type()
     {
@@ -614,7 +888,7 @@ namespace ops
         return handle;
     }
 
-    [[noreturn]] void throw_(gc_obj_ref<::System_Private_CoreLib::System::Exception> obj);
+    [[noreturn]] NATSU_COLD void throw_(gc_obj_ref<::System_Private_CoreLib::System::Exception> obj);
 
     template <class T>
     constexpr auto unsign(T value) noexcept
@@ -804,6 +1078,7 @@ template <class T>
 template <class T>
 void Internal::Runtime::CompilerServices::Unsafe::_s_WriteUnaligned(::natsu::gc_ptr<void> destination, ::natsu::variable_type_t<T> value)
 {
+    natsu::gc_barrier(*reinterpret_cast<::natsu::variable_type_t<T> *>(destination.ptr_));
     if constexpr (natsu::is_value_type_v<T>)
         std::memcpy(destination.ptr_, &value, sizeof(T));
     else
@@ -813,6 +1088,7 @@ void Internal::Runtime::CompilerServices::Unsafe::_s_WriteUnaligned(::natsu::gc_
 template <class T>
 void Internal::Runtime::CompilerServices::Unsafe::_s_WriteUnaligned(::natsu::gc_ref<uint8_t> destination, ::natsu::variable_type_t<T> value)
 {
+    natsu::gc_barrier(*reinterpret_cast<::natsu::variable_type_t<T> *>(destination.ptr_));
     if constexpr (natsu::is_value_type_v<T>)
         std::memcpy(destination.ptr_, &value, sizeof(T));
     else
@@ -840,13 +1116,13 @@ System::IntPtr Internal::Runtime::CompilerServices::Unsafe::_s_ByteOffset(::nats
 template <class T>
 bool System::Runtime::CompilerServices::RuntimeHelpers::_s_IsReferenceOrContainsReferences()
 {
-    return true;
+    return ::natsu::is_reference_or_contains_references_v<T>;
 }
 
 template <class T>
 bool System::Runtime::CompilerServices::RuntimeHelpers::_s_IsBitwiseEquatable()
 {
-    return false;
+    return ::natsu::is_bitwise_equatable_v<T>;
 }
 
 template <class T>
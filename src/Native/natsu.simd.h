@@ -0,0 +1,495 @@
+// natsu clr simd support
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// Vectors lower to GCC/Clang vector extensions, the C++ compiler turns them into SSE/AVX, NEON or scalar code
+// depending on the target. MSVC targeting x86 with SSE2 uses the intrinsics, other compilers get plain element loops.
+#ifndef NATSU_SIMD_VECTOR_EXT
+#if defined(__GNUC__) || defined(__clang__)
+#define NATSU_SIMD_VECTOR_EXT 1
+#else
+#define NATSU_SIMD_VECTOR_EXT 0
+#endif
+#endif
+
+#ifndef NATSU_SIMD_SSE2
+#if !NATSU_SIMD_VECTOR_EXT && defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NATSU_SIMD_SSE2 1
+#else
+#define NATSU_SIMD_SSE2 0
+#endif
+#endif
+
+#if NATSU_SIMD_SSE2
+#include <immintrin.h>
+#endif
+
+namespace natsu
+{
+namespace simd
+{
+#if (NATSU_SIMD_VECTOR_EXT && (defined(__SSE2__) || defined(__ARM_NEON) || defined(__riscv_vector))) || NATSU_SIMD_SSE2
+    constexpr bool is_hardware_accelerated = true;
+#else
+    constexpr bool is_hardware_accelerated = false;
+#endif
+
+    namespace details
+    {
+        template <size_t Size>
+        struct mask_element;
+
+        template <>
+        struct mask_element<1>
+        {
+            using type = int8_t;
+        };
+
+        template <>
+        struct mask_element<2>
+        {
+            using type = int16_t;
+        };
+
+        template <>
+        struct mask_element<4>
+        {
+            using type = int32_t;
+        };
+
+        template <>
+        struct mask_element<8>
+        {
+            using type = int64_t;
+        };
+
+        // TVec is the managed vector struct, only its size matters here
+        template <class T, class TVec>
+        struct vector_traits
+        {
+            static constexpr size_t count = sizeof(TVec) / sizeof(T);
+
+            using mask_element_t = typename mask_element<sizeof(T)>::type;
+
+#if NATSU_SIMD_VECTOR_EXT
+            typedef T native_t __attribute__((vector_size(sizeof(TVec))));
+            typedef mask_element_t mask_t __attribute__((vector_size(sizeof(TVec))));
+#endif
+
+            struct elements_t
+            {
+                T value[count];
+            };
+
+            struct mask_elements_t
+            {
+                mask_element_t value[count];
+            };
+        };
+
+        template <class TTo, class TFrom>
+        TTo bit_cast(const TFrom &value) noexcept
+        {
+            static_assert(sizeof(TTo) == sizeof(TFrom));
+            TTo result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        template <class T, class TVec, class TOp>
+        TVec map(const TVec &value, TOp op) noexcept
+        {
+            using traits = vector_traits<T, TVec>;
+            auto v = bit_cast<typename traits::elements_t>(value);
+            for (size_t i = 0; i < traits::count; i++)
+                v.value[i] = op(v.value[i]);
+            return bit_cast<TVec>(v);
+        }
+
+        template <class T, class TVec, class TOp>
+        TVec map(const TVec &left, const TVec &right, TOp op) noexcept
+        {
+            using traits = vector_traits<T, TVec>;
+            auto l = bit_cast<typename traits::elements_t>(left);
+            auto r = bit_cast<typename traits::elements_t>(right);
+            for (size_t i = 0; i < traits::count; i++)
+                l.value[i] = op(l.value[i], r.value[i]);
+            return bit_cast<TVec>(l);
+        }
+
+        // Lanes where the predicate holds become all bits set, the others zero
+        template <class T, class TVec, class TOp>
+        TVec compare(const TVec &left, const TVec &right, TOp op) noexcept
+        {
+            using traits = vector_traits<T, TVec>;
+            auto l = bit_cast<typename traits::elements_t>(left);
+            auto r = bit_cast<typename traits::elements_t>(right);
+            typename traits::mask_elements_t result;
+            for (size_t i = 0; i < traits::count; i++)
+                result.value[i] = op(l.value[i], r.value[i]) ? -1 : 0;
+            return bit_cast<TVec>(result);
+        }
+
+        template <class TVec, class TOp>
+        TVec map_bits(const TVec &left, const TVec &right, TOp op) noexcept
+        {
+            using traits = vector_traits<uint8_t, TVec>;
+            auto l = bit_cast<typename traits::elements_t>(left);
+            auto r = bit_cast<typename traits::elements_t>(right);
+            for (size_t i = 0; i < traits::count; i++)
+                l.value[i] = op(l.value[i], r.value[i]);
+            return bit_cast<TVec>(l);
+        }
+
+#if NATSU_SIMD_SSE2
+        // Stands in for an instruction SSE2 doesn't have for a lane type
+        struct sse2_unsupported
+        {
+        };
+
+        template <class TReg>
+        sse2_unsupported sse2_none(TReg, TReg) noexcept
+        {
+            return {};
+        }
+
+        template <class TReg, class TOp>
+        constexpr bool sse2_supports = !std::is_same_v<std::invoke_result_t<TOp, TReg, TReg>, sse2_unsupported>;
+
+        template <class TReg, class TVec, class TOp>
+        TVec sse2_apply(const TVec &left, const TVec &right, TOp op) noexcept
+        {
+            return bit_cast<TVec>(op(bit_cast<TReg>(left), bit_cast<TReg>(right)));
+        }
+
+        // Picks the instruction for the lane type, lane types without one run the element loop
+        template <class T, class TVec, class TPs, class TPd, class TEpi8, class TEpi16, class TEpi32, class TEpi64, class TFallback>
+        TVec sse2_binary(const TVec &left, const TVec &right, TPs ps, TPd pd, TEpi8 epi8, TEpi16 epi16, TEpi32 epi32, TEpi64 epi64, TFallback fallback) noexcept
+        {
+            if constexpr (sizeof(TVec) != sizeof(__m128i))
+                return fallback();
+            else if constexpr (std::is_same_v<T, float> && sse2_supports<__m128, TPs>)
+                return sse2_apply<__m128>(left, right, ps);
+            else if constexpr (std::is_same_v<T, double> && sse2_supports<__m128d, TPd>)
+                return sse2_apply<__m128d>(left, right, pd);
+            else if constexpr (std::is_integral_v<T> && sizeof(T) == 1 && sse2_supports<__m128i, TEpi8>)
+                return sse2_apply<__m128i>(left, right, epi8);
+            else if constexpr (std::is_integral_v<T> && sizeof(T) == 2 && sse2_supports<__m128i, TEpi16>)
+                return sse2_apply<__m128i>(left, right, epi16);
+            else if constexpr (std::is_integral_v<T> && sizeof(T) == 4 && sse2_supports<__m128i, TEpi32>)
+                return sse2_apply<__m128i>(left, right, epi32);
+            else if constexpr (std::is_integral_v<T> && sizeof(T) == 8 && sse2_supports<__m128i, TEpi64>)
+                return sse2_apply<__m128i>(left, right, epi64);
+            else
+                return fallback();
+        }
+#endif
+    }
+
+#if NATSU_SIMD_VECTOR_EXT
+#define NATSU_SIMD_ARITHMETIC(name, op, ps, pd, epi8, epi16, epi32, epi64)                    \
+    template <class T, class TVec>                                                           \
+    TVec name(const TVec &left, const TVec &right) noexcept                                  \
+    {                                                                                        \
+        using native_t = typename details::vector_traits<T, TVec>::native_t;                 \
+        return details::bit_cast<TVec>(details::bit_cast<native_t>(left) op details::bit_cast<native_t>(right)); \
+    }
+
+// Comparisons yield lanes of all bits set or zero, which is what the vector extensions produce
+#define NATSU_SIMD_COMPARE(name, op, ps, pd, epi8, epi16, epi32, epi64) NATSU_SIMD_ARITHMETIC(name, op, ps, pd, epi8, epi16, epi32, epi64)
+#elif NATSU_SIMD_SSE2
+#define NATSU_SIMD_SSE2_OP(intrinsic) [](auto l, auto r) noexcept { return intrinsic(l, r); }
+
+#define NATSU_SIMD_ARITHMETIC(name, op, ps, pd, epi8, epi16, epi32, epi64)                    \
+    template <class T, class TVec>                                                           \
+    TVec name(const TVec &left, const TVec &right) noexcept                                  \
+    {                                                                                        \
+        return details::sse2_binary<T>(left, right, NATSU_SIMD_SSE2_OP(ps), NATSU_SIMD_SSE2_OP(pd), \
+            NATSU_SIMD_SSE2_OP(epi8), NATSU_SIMD_SSE2_OP(epi16), NATSU_SIMD_SSE2_OP(epi32), NATSU_SIMD_SSE2_OP(epi64), \
+            [&] { return details::map<T>(left, right, [](T l, T r) { return T(l op r); }); }); \
+    }
+
+#define NATSU_SIMD_COMPARE(name, op, ps, pd, epi8, epi16, epi32, epi64)                       \
+    template <class T, class TVec>                                                           \
+    TVec name(const TVec &left, const TVec &right) noexcept                                  \
+    {                                                                                        \
+        return details::sse2_binary<T>(left, right, NATSU_SIMD_SSE2_OP(ps), NATSU_SIMD_SSE2_OP(pd), \
+            NATSU_SIMD_SSE2_OP(epi8), NATSU_SIMD_SSE2_OP(epi16), NATSU_SIMD_SSE2_OP(epi32), NATSU_SIMD_SSE2_OP(epi64), \
+            [&] { return details::compare<T>(left, right, [](T l, T r) { return l op r; }); }); \
+    }
+#else
+#define NATSU_SIMD_ARITHMETIC(name, op, ps, pd, epi8, epi16, epi32, epi64)                    \
+    template <class T, class TVec>                                                           \
+    TVec name(const TVec &left, const TVec &right) noexcept                                  \
+    {                                                                                        \
+        return details::map<T>(left, right, [](T l, T r) { return T(l op r); });             \
+    }
+
+#define NATSU_SIMD_COMPARE(name, op, ps, pd, epi8, epi16, epi32, epi64)                       \
+    template <class T, class TVec>                                                           \
+    TVec name(const TVec &left, const TVec &right) noexcept                                  \
+    {                                                                                        \
+        return details::compare<T>(left, right, [](T l, T r) { return l op r; });            \
+    }
+#endif
+
+    // The trailing arguments name the SSE2 instruction per lane type. SSE2 only has signed integer ordering and
+    // no 32 or 64-bit integer multiply or 64-bit integer compare, those lanes run the element loop.
+    NATSU_SIMD_ARITHMETIC(add, +, _mm_add_ps, _mm_add_pd, _mm_add_epi8, _mm_add_epi16, _mm_add_epi32, _mm_add_epi64)
+    NATSU_SIMD_ARITHMETIC(subtract, -, _mm_sub_ps, _mm_sub_pd, _mm_sub_epi8, _mm_sub_epi16, _mm_sub_epi32, _mm_sub_epi64)
+    NATSU_SIMD_ARITHMETIC(multiply, *, _mm_mul_ps, _mm_mul_pd, details::sse2_none, _mm_mullo_epi16, details::sse2_none, details::sse2_none)
+    NATSU_SIMD_ARITHMETIC(float_divide, /, _mm_div_ps, _mm_div_pd, details::sse2_none, details::sse2_none, details::sse2_none, details::sse2_none)
+
+    NATSU_SIMD_COMPARE(equals, ==, _mm_cmpeq_ps, _mm_cmpeq_pd, _mm_cmpeq_epi8, _mm_cmpeq_epi16, _mm_cmpeq_epi32, details::sse2_none)
+    NATSU_SIMD_COMPARE(less_than, <, _mm_cmplt_ps, _mm_cmplt_pd, details::sse2_none, details::sse2_none, details::sse2_none, details::sse2_none)
+    NATSU_SIMD_COMPARE(less_than_or_equal, <=, _mm_cmple_ps, _mm_cmple_pd, details::sse2_none, details::sse2_none, details::sse2_none, details::sse2_none)
+    NATSU_SIMD_COMPARE(greater_than, >, _mm_cmpgt_ps, _mm_cmpgt_pd, details::sse2_none, details::sse2_none, details::sse2_none, details::sse2_none)
+    NATSU_SIMD_COMPARE(greater_than_or_equal, >=, _mm_cmpge_ps, _mm_cmpge_pd, details::sse2_none, details::sse2_none, details::sse2_none, details::sse2_none)
+
+#undef NATSU_SIMD_ARITHMETIC
+#undef NATSU_SIMD_COMPARE
+#undef NATSU_SIMD_SSE2_OP
+
+    // Integer lanes divide like scalar division does, a zero divisor throws and so does MinValue / -1 in lanes of
+    // 32 bits or more, narrower lanes are promoted and wrap. No target divides integer vectors, so these lanes
+    // always run the element loop.
+    template <class T, class TVec>
+    TVec divide(const TVec &left, const TVec &right)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            return float_divide<T>(left, right);
+        }
+        else
+        {
+            using traits = details::vector_traits<T, TVec>;
+            auto l = details::bit_cast<typename traits::elements_t>(left);
+            auto r = details::bit_cast<typename traits::elements_t>(right);
+            for (size_t i = 0; i < traits::count; i++)
+            {
+                if (r.value[i] == 0)
+                    throw_divide_by_zero_exception();
+                if constexpr (std::is_signed_v<T> && sizeof(T) >= sizeof(int32_t))
+                {
+                    if (r.value[i] == T(-1) && l.value[i] == std::numeric_limits<T>::min())
+                        throw_overflow_exception();
+                }
+
+                l.value[i] = T(l.value[i] / r.value[i]);
+            }
+
+            return details::bit_cast<TVec>(l);
+        }
+    }
+
+    // Bitwise operations work on the bits of any element type, floating point included
+    template <class T, class TVec>
+    TVec bitwise_and(const TVec &left, const TVec &right) noexcept
+    {
+#if NATSU_SIMD_VECTOR_EXT
+        using mask_t = typename details::vector_traits<T, TVec>::mask_t;
+        return details::bit_cast<TVec>(details::bit_cast<mask_t>(left) & details::bit_cast<mask_t>(right));
+#else
+#if NATSU_SIMD_SSE2
+        if constexpr (sizeof(TVec) == sizeof(__m128i))
+            return details::sse2_apply<__m128i>(left, right, [](__m128i l, __m128i r) noexcept { return _mm_and_si128(l, r); });
+        else
+#endif
+            return details::map_bits(left, right, [](uint8_t l, uint8_t r) { return uint8_t(l & r); });
+#endif
+    }
+
+    template <class T, class TVec>
+    TVec bitwise_or(const TVec &left, const TVec &right) noexcept
+    {
+#if NATSU_SIMD_VECTOR_EXT
+        using mask_t = typename details::vector_traits<T, TVec>::mask_t;
+        return details::bit_cast<TVec>(details::bit_cast<mask_t>(left) | details::bit_cast<mask_t>(right));
+#else
+#if NATSU_SIMD_SSE2
+        if constexpr (sizeof(TVec) == sizeof(__m128i))
+            return details::sse2_apply<__m128i>(left, right, [](__m128i l, __m128i r) noexcept { return _mm_or_si128(l, r); });
+        else
+#endif
+            return details::map_bits(left, right, [](uint8_t l, uint8_t r) { return uint8_t(l | r); });
+#endif
+    }
+
+    template <class T, class TVec>
+    TVec exclusive_or(const TVec &left, const TVec &right) noexcept
+    {
+#if NATSU_SIMD_VECTOR_EXT
+        using mask_t = typename details::vector_traits<T, TVec>::mask_t;
+        return details::bit_cast<TVec>(details::bit_cast<mask_t>(left) ^ details::bit_cast<mask_t>(right));
+#else
+#if NATSU_SIMD_SSE2
+        if constexpr (sizeof(TVec) == sizeof(__m128i))
+            return details::sse2_apply<__m128i>(left, right, [](__m128i l, __m128i r) noexcept { return _mm_xor_si128(l, r); });
+        else
+#endif
+            return details::map_bits(left, right, [](uint8_t l, uint8_t r) { return uint8_t(l ^ r); });
+#endif
+    }
+
+    template <class T, class TVec>
+    TVec ones_complement(const TVec &value) noexcept
+    {
+#if NATSU_SIMD_VECTOR_EXT
+        using mask_t = typename details::vector_traits<T, TVec>::mask_t;
+        return details::bit_cast<TVec>(~details::bit_cast<mask_t>(value));
+#else
+#if NATSU_SIMD_SSE2
+        if constexpr (sizeof(TVec) == sizeof(__m128i))
+            return exclusive_or<T>(value, details::bit_cast<TVec>(_mm_set1_epi32(-1)));
+        else
+#endif
+            return details::map_bits(value, value, [](uint8_t l, uint8_t) { return uint8_t(~l); });
+#endif
+    }
+
+    template <class T, class TVec>
+    TVec create(T value) noexcept;
+
+    template <class T, class TVec>
+    TVec negate(const TVec &value) noexcept
+    {
+#if NATSU_SIMD_VECTOR_EXT
+        using native_t = typename details::vector_traits<T, TVec>::native_t;
+        return details::bit_cast<TVec>(-details::bit_cast<native_t>(value));
+#else
+#if NATSU_SIMD_SSE2
+        // Flipping the sign bit keeps the sign of zero, subtracting from zero wouldn't
+        if constexpr (std::is_floating_point_v<T>)
+            return exclusive_or<T>(value, create<T, TVec>(T(-0.0)));
+        else
+            return subtract<T>(TVec {}, value);
+#else
+        return details::map<T>(value, [](T v) { return T(-v); });
+#endif
+#endif
+    }
+
+    // Bits of left where condition is set, bits of right elsewhere
+    template <class T, class TVec>
+    TVec conditional_select(const TVec &condition, const TVec &left, const TVec &right) noexcept
+    {
+        return bitwise_or<T>(bitwise_and<T>(condition, left), bitwise_and<T>(ones_complement<T>(condition), right));
+    }
+
+    template <class T, class TVec>
+    TVec min(const TVec &left, const TVec &right) noexcept
+    {
+        return conditional_select<T>(less_than<T>(left, right), left, right);
+    }
+
+    template <class T, class TVec>
+    TVec max(const TVec &left, const TVec &right) noexcept
+    {
+        return conditional_select<T>(greater_than<T>(left, right), left, right);
+    }
+
+    template <class T, class TVec>
+    TVec abs(const TVec &value) noexcept
+    {
+        if constexpr (std::is_unsigned_v<T>)
+            return value;
+        else
+            return conditional_select<T>(less_than<T>(value, TVec {}), negate<T>(value), value);
+    }
+
+    template <class T, class TVec>
+    TVec sqrt(const TVec &value) noexcept
+    {
+#if NATSU_SIMD_SSE2
+        if constexpr (sizeof(TVec) == sizeof(__m128) && std::is_same_v<T, float>)
+            return details::sse2_apply<__m128>(value, value, [](__m128 v, __m128) noexcept { return _mm_sqrt_ps(v); });
+        else if constexpr (sizeof(TVec) == sizeof(__m128d) && std::is_same_v<T, double>)
+            return details::sse2_apply<__m128d>(value, value, [](__m128d v, __m128d) noexcept { return _mm_sqrt_pd(v); });
+        else
+#endif
+            return details::map<T>(value, [](T v) { return T(std::sqrt(v)); });
+    }
+
+    // True if every lane compares equal
+    template <class T, class TVec>
+    bool equals_all(const TVec &left, const TVec &right) noexcept
+    {
+        using traits = details::vector_traits<T, TVec>;
+        auto mask = details::bit_cast<typename traits::mask_elements_t>(equals<T>(left, right));
+        typename traits::mask_element_t result = -1;
+        for (size_t i = 0; i < traits::count; i++)
+            result &= mask.value[i];
+        return result != 0;
+    }
+
+    template <class TVec>
+    TVec all_bits_set() noexcept
+    {
+        TVec result;
+        std::memset(&result, 0xFF, sizeof(result));
+        return result;
+    }
+
+    template <class T, class TVec>
+    TVec create(T value) noexcept
+    {
+        using traits = details::vector_traits<T, TVec>;
+        typename traits::elements_t result;
+        for (size_t i = 0; i < traits::count; i++)
+            result.value[i] = value;
+        return details::bit_cast<TVec>(result);
+    }
+
+    template <class TVec, class TRef>
+    TVec load(TRef source) noexcept
+    {
+        TVec result;
+        std::memcpy(&result, source.ptr_, sizeof(result));
+        return result;
+    }
+
+    template <class TVec, class TRef>
+    void store(const TVec &source, TRef destination) noexcept
+    {
+        std::memcpy(destination.ptr_, &source, sizeof(source));
+    }
+
+    // Lanes with an index out of range become zero
+    template <class T, class TIndex, class TVec, class TIndexVec>
+    TVec shuffle(const TVec &vector, const TIndexVec &indices) noexcept
+    {
+        using traits = details::vector_traits<T, TVec>;
+        auto v = details::bit_cast<typename traits::elements_t>(vector);
+        auto index = details::bit_cast<typename details::vector_traits<TIndex, TIndexVec>::elements_t>(indices);
+        typename traits::elements_t result;
+        for (size_t i = 0; i < traits::count; i++)
+        {
+            auto selected = static_cast<std::make_unsigned_t<TIndex>>(index.value[i]);
+            result.value[i] = selected < traits::count ? v.value[selected] : T();
+        }
+
+        return details::bit_cast<TVec>(result);
+    }
+
+    template <class T, class TVec>
+    T sum(const TVec &value) noexcept
+    {
+        using traits = details::vector_traits<T, TVec>;
+        auto v = details::bit_cast<typename traits::elements_t>(value);
+        T result = T();
+        for (size_t i = 0; i < traits::count; i++)
+            result += v.value[i];
+        return result;
+    }
+
+    template <class T, class TVec>
+    T dot(const TVec &left, const TVec &right) noexcept
+    {
+        return sum<T>(multiply<T>(left, right));
+    }
+}
+}
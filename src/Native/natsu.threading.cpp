@@ -30,6 +30,7 @@ int64_t Interlocked::_s_Exchange(gc_ref<int64_t> location1, int64_t value)
 
 gc_obj_ref<Object> Interlocked::_s_Exchange(gc_ref<gc_obj_ref<Object>> location1, gc_obj_ref<Object> value)
 {
+    gc_barrier(*location1);
 #if _MSC_VER
     return gc_obj_ref<Object>(reinterpret_cast<Object *>(_InterlockedExchangePointer(
         reinterpret_cast<void *volatile *>(location1.ptr_), reinterpret_cast<void *>(value.ptr_))));
@@ -59,6 +60,7 @@ int64_t Interlocked::_s_CompareExchange(gc_ref<int64_t> location1, int64_t value
 
 gc_obj_ref<Object> Interlocked::_s_CompareExchange(gc_ref<gc_obj_ref<Object>> location1, gc_obj_ref<Object> value, gc_obj_ref<Object> comparand)
 {
+    gc_barrier(*location1);
 #if _MSC_VER
     return gc_obj_ref<Object>(reinterpret_cast<Object *>(_InterlockedCompareExchangePointer(
         reinterpret_cast<void *volatile *>(location1.ptr_), reinterpret_cast<void *>(value.ptr_),
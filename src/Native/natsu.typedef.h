@@ -3,14 +3,41 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <new>
 #include <string_view>
 #include <type_traits>
 #include <utility>
 
 using namespace std::string_view_literals;
 
+// Profile guided layout, hot methods get the sections Generated/natsu.order.ld lists in profile order,
+// methods the profile never entered and throw paths go to the cold text
+#if defined(__GNUC__) || defined(__clang__)
+#define NATSU_HOT(name) __attribute__((hot, section(name)))
+#define NATSU_COLD __attribute__((cold))
+#else
+#define NATSU_HOT(name)
+#define NATSU_COLD
+#endif
+
+#if _MSC_VER
+#define NATSU_FORCEINLINE __forceinline
+#else
+#define NATSU_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+// Profiling builds count the entries of every method, the counts are dumped when the app exits
+#if NATSU_PROFILE
+#define NATSU_PROFILE_ENTRY(name)                                \
+    static ::natsu::profile_counter _profile_counter(name); \
+    _profile_counter.count_.fetch_add(1, std::memory_order_relaxed)
+#else
+#define NATSU_PROFILE_ENTRY(name) ((void)0)
+#endif
+
 namespace System_Private_CoreLib
 {
 namespace System
@@ -56,11 +83,26 @@ struct gc_ptr;
 struct clr_vtable;
 struct clr_exception;
 
-[[noreturn]] void throw_null_ref_exception();
-[[noreturn]] void throw_invalid_cast_exception();
-[[noreturn]] void throw_index_out_of_range_exception();
-[[noreturn]] void throw_overflow_exception();
-[[noreturn]] void pure_call();
+[[noreturn]] NATSU_COLD void throw_null_ref_exception();
+[[noreturn]] NATSU_COLD void throw_invalid_cast_exception();
+[[noreturn]] NATSU_COLD void throw_index_out_of_range_exception();
+[[noreturn]] NATSU_COLD void throw_overflow_exception();
+[[noreturn]] NATSU_COLD void throw_divide_by_zero_exception();
+[[noreturn]] NATSU_COLD void pure_call();
+
+#if NATSU_PROFILE
+// Counters link themselves into a list the first time their method runs
+struct profile_counter
+{
+    const char *name_;
+    std::atomic<uint32_t> count_;
+    profile_counter *next_;
+
+    profile_counter(const char *name) noexcept;
+};
+
+void dump_profile();
+#endif
 
 template <class T>
 void check_null_obj_ref(gc_obj_ref<T> obj)
@@ -98,14 +140,56 @@ inline constexpr void nop() noexcept
 {
 }
 
+template <class T>
+struct gc_refs_holder;
+
+struct gc_root
+{
+    const void *base_;
+    const uint32_t *refs_;
+    uint32_t refs_count_;
+};
+
+struct gc_static_root
+{
+    gc_root root_;
+    gc_static_root *next_;
+
+    gc_static_root(const void *base, const uint32_t *refs, uint32_t refs_count) noexcept;
+};
+
 template <class T>
 struct static_holder
 {
     static T &get()
     {
-        static T value;
+        // Storage is zero-initialized, so it can be registered as a root before the cctor runs
+        static gc_static_root root(storage_, gc_refs_holder<T>::value.data(), (uint32_t)gc_refs_holder<T>::value.size());
+        static T &value = *new (storage_) T();
         return value;
     }
+
+private:
+    alignas(T) static inline uint8_t storage_[sizeof(T)];
+};
+
+// Statics of non-generic types, constructed once by the module's init_statics in cctor dependency order
+template <class T>
+struct static_storage
+{
+    static T &get() noexcept
+    {
+        return *reinterpret_cast<T *>(storage_);
+    }
+
+    static void init()
+    {
+        static gc_static_root root(storage_, gc_refs_holder<T>::value.data(), (uint32_t)gc_refs_holder<T>::value.size());
+        new (storage_) T();
+    }
+
+private:
+    alignas(T) static inline uint8_t storage_[sizeof(T)];
 };
 
 template <class T>
@@ -121,7 +205,9 @@ struct vtable_holder
 
 enum object_attributes
 {
-    OBJ_ATTR_NONE
+    OBJ_ATTR_NONE,
+    OBJ_ATTR_MARKED = 1,
+    OBJ_ATTR_OLD = 2
 };
 
 struct object_sync_header
@@ -147,10 +233,10 @@ struct object_header
     }
 
     template <class TVTable>
-    const TVTable *vtable_as() const noexcept
-    {
-        return dynamic_cast<const TVTable *>(vtable_);
-    }
+    const TVTable *vtable_as() const noexcept;
+
+    template <class TIFace>
+    const TIFace *interface_vtable() const noexcept;
 };
 
 template <class T>
@@ -189,9 +275,12 @@ using to_clr_type_t = typename to_clr_type<T>::type;
 template <class T>
 constexpr bool is_value_type_v = to_clr_type_t<T>::TypeInfo::IsValueType;
 
+template <class TFromVTable, class TToVTable>
+constexpr bool is_vtable_convertible() noexcept;
+
 // clang-format off
 template <class TFrom, class TTo>
-constexpr bool is_convertible_v = std::is_convertible_v<typename to_clr_type_t<TFrom>::VTable *, typename to_clr_type_t<TTo>::VTable *>;
+constexpr bool is_convertible_v = is_vtable_convertible<typename to_clr_type_t<TFrom>::VTable, typename to_clr_type_t<TTo>::VTable>();
 // clang-format on
 
 template <class T>
@@ -593,12 +682,171 @@ struct gc_obj_ref
     }
 };
 
+// GC reference maps: offsets of object references inside a type
+template <class T, class = void>
+struct gc_refs_of
+{
+    static constexpr std::array<uint32_t, 0> get() noexcept
+    {
+        return {};
+    }
+};
+
+template <class T>
+struct gc_refs_of<gc_obj_ref<T>>
+{
+    static constexpr std::array<uint32_t, 1> get() noexcept
+    {
+        return { 0 };
+    }
+};
+
+// Byrefs may point into the middle of an object, the collector looks up the object containing them
+inline constexpr uint32_t gc_interior_ref_bit = 0x80000000;
+
+template <class T>
+struct gc_refs_of<gc_ref<T>>
+{
+    static constexpr std::array<uint32_t, 1> get() noexcept
+    {
+        return { gc_interior_ref_bit };
+    }
+};
+
+template <class T>
+struct gc_refs_of<clr_volatile<T>> : gc_refs_of<T>
+{
+};
+
+template <class T>
+struct gc_refs_of<T, std::void_t<decltype(T::TypeInfo::GCRefs())>>
+{
+    static constexpr auto get() noexcept
+    {
+        return T::TypeInfo::GCRefs();
+    }
+};
+
+template <class TField>
+constexpr auto gc_field_refs(size_t offset) noexcept
+{
+    // Offsets keep the interior bit, objects are far smaller than 2GB
+    auto refs = gc_refs_of<TField>::get();
+    for (auto &ref : refs)
+        ref += (uint32_t)offset;
+    return refs;
+}
+
+constexpr std::array<uint32_t, 0> gc_refs_concat() noexcept
+{
+    return {};
+}
+
+template <size_t N>
+constexpr std::array<uint32_t, N> gc_refs_concat(const std::array<uint32_t, N> &refs) noexcept
+{
+    return refs;
+}
+
+template <size_t N, size_t M>
+constexpr std::array<uint32_t, N + M> gc_refs_concat(const std::array<uint32_t, N> &lhs, const std::array<uint32_t, M> &rhs) noexcept
+{
+    std::array<uint32_t, N + M> refs {};
+    for (size_t i = 0; i < N; i++)
+        refs[i] = lhs[i];
+    for (size_t i = 0; i < M; i++)
+        refs[N + i] = rhs[i];
+    return refs;
+}
+
+template <size_t N, size_t M, class... TRest>
+constexpr auto gc_refs_concat(const std::array<uint32_t, N> &lhs, const std::array<uint32_t, M> &rhs, const TRest &... rest) noexcept
+{
+    return gc_refs_concat(gc_refs_concat(lhs, rhs), rest...);
+}
+
+template <class T>
+struct gc_refs_holder
+{
+    static constexpr auto value = gc_refs_of<T>::get();
+};
+
+template <class T>
+constexpr bool is_reference_or_contains_references_v = gc_refs_holder<variable_type_t<T>>::value.size() != 0;
+
+// Only generated value types can be bitwise equatable, references and pointers never are
+template <class T, class = void>
+struct is_bitwise_equatable : std::false_type
+{
+};
+
+template <class T>
+struct is_bitwise_equatable<T, std::void_t<decltype(to_clr_type_t<T>::TypeInfo::IsBitwiseEquatable())>>
+    : std::bool_constant<to_clr_type_t<T>::TypeInfo::IsBitwiseEquatable()>
+{
+};
+
+template <class T>
+constexpr bool is_bitwise_equatable_v = is_bitwise_equatable<T>::value;
+
+template <class... T>
+struct type_list
+{
+};
+
+// Identifies a vtable type in the type hierarchy tables, it's writable so the linker never folds two ids together
+template <class TVTable>
+struct vtable_id
+{
+    static inline char value;
+};
+
+// Allocations of a type since startup, kept in RAM apart from the read-only vtable.
+// Types are listed the first time they are allocated. The allocation path leaves them alone, objects bumped off a
+// thread's buffer are counted when the buffer is retired or the statistics are queried.
+struct gc_alloc_stats
+{
+    std::atomic<uint32_t> count;
+    std::atomic<uint64_t> bytes;
+    const clr_vtable *vtable;
+    gc_alloc_stats *next;
+};
+
+template <class TVTable>
+struct vtable_alloc_stats
+{
+    static inline gc_alloc_stats value;
+};
+
+// The interface vtable a type implements an interface by, types share it with their base when they override nothing in it
+struct clr_interface_entry
+{
+    const void *Id;
+    const void *VTable;
+};
+
+// Interface map of the types implementing no interface, so probing the home slot never needs a bounds check
+inline constexpr clr_interface_entry empty_interface_map = { nullptr, nullptr };
+
 struct clr_vtable
 {
+    using interfaces_t = type_list<>;
+
     uint32_t ElementSize;
+    // Reference offsets of the object, or of each element for arrays, tagged by gc_interior_ref_bit for byrefs
+    uint32_t GCRefsCount;
+    const uint32_t *GCRefs;
+    gc_alloc_stats *AllocStats;
+    // Base classes from System.Object down to the type itself, indexed by class depth
+    uint32_t ClassDepth;
+    const void *const *ClassDisplay;
+    // Every interface the type implements, hashed by InterfaceId into a power of two table probed linearly
+    uint16_t InterfacesMask;
+    uint16_t InterfacesProbes;
+    const clr_interface_entry *Interfaces;
 
     constexpr clr_vtable()
-        : ElementSize(0)
+        : ElementSize(0), GCRefsCount(0), GCRefs(nullptr), AllocStats(&vtable_alloc_stats<clr_vtable>::value), ClassDepth(0), ClassDisplay(nullptr), InterfacesMask(0), InterfacesProbes(0), Interfaces(&empty_interface_map)
     {
     }
 
@@ -611,6 +859,11 @@ struct clr_vtable
     constexpr void override_vfunc_impl(std::string_view name, TFunc func)
     {
     }
+
+    template <class TIFace>
+    static constexpr void override_itable(TIFace &itable) noexcept
+    {
+    }
 };
 
 struct clr_exception
@@ -624,6 +877,143 @@ struct clr_exception
     gc_obj_ref<::System_Private_CoreLib::System::Exception> exception_;
 };
 
+struct gc_frame_base
+{
+    gc_frame_base *prev_;
+    const gc_root *roots_;
+    uint32_t roots_count_;
+};
+
+// Every allocation in a thread allocation buffer starts with its size, so the collector can walk the buffer
+struct alignas(8) gc_tlab_unit
+{
+    size_t size_;
+};
+
+// Heap allocations keep the alignment of a unit. Buffers only serve units up to gc_tlab_max_unit_size,
+// larger objects go to the slabs or the free list so they never pin a buffer chunk.
+inline constexpr size_t gc_alloc_alignment = alignof(gc_tlab_unit);
+inline constexpr size_t gc_tlab_max_unit_size = 256;
+
+constexpr size_t gc_tlab_unit_size(size_t size) noexcept
+{
+    return (sizeof(gc_tlab_unit) + sizeof(object_header) + size + gc_alloc_alignment - 1) & ~(gc_alloc_alignment - 1);
+}
+
+struct gc_thread_context
+{
+    gc_frame_base *frames_;
+    gc_thread_context *prev_;
+    gc_thread_context *next_;
+
+    // Thread allocation buffer, left out of the constructor so allocations made before it runs are kept
+    uint8_t *alloc_ptr_;
+    uint8_t *alloc_limit_;
+    uint8_t *alloc_end_;
+    // Start of the units bumped off the buffer that are not in the allocation statistics yet
+    uint8_t *alloc_counted_;
+    // Bytes left before the thread's next allocation is sampled. Only the thread counts it down, other threads
+    // just store to it to re-arm it, so it needs no read-modify-write.
+    std::atomic<int64_t> sample_countdown_;
+    // Nesting of gc_unsafe_region, the thread may only be stopped for a collection while it is 0
+    uint32_t unsafe_depth_;
+
+    gc_thread_context() noexcept;
+    gc_thread_context(const gc_thread_context &) = delete;
+    ~gc_thread_context();
+
+    bool at_safepoint() const noexcept
+    {
+        return !unsafe_depth_;
+    }
+
+    // Stops reporting the shadow stack, for threads that are terminated without unwinding
+    void detach() noexcept;
+};
+
+#ifdef _WIN32
+// Every Chino thread of the emulator runs on a host thread of its own
+inline thread_local gc_thread_context gc_host_thread;
+
+inline gc_thread_context &gc_current_thread() noexcept
+{
+    return gc_host_thread;
+}
+#else
+// Bare-metal ports give every thread a context and switch to it along with the registers
+inline gc_thread_context gc_boot_thread;
+inline gc_thread_context *gc_running_thread = &gc_boot_thread;
+
+inline gc_thread_context &gc_current_thread() noexcept
+{
+    return *gc_running_thread;
+}
+
+inline void gc_switch_thread(gc_thread_context &thread) noexcept
+{
+    gc_running_thread = &thread;
+}
+#endif
+
+// Allocations and write barrier slow paths update the shared heap state, an interrupt that
+// preempts a thread inside one must not collect until the thread leaves it
+class gc_unsafe_region
+{
+public:
+    gc_unsafe_region() noexcept
+        : thread_(gc_current_thread())
+    {
+        thread_.unsafe_depth_++;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    gc_unsafe_region(const gc_unsafe_region &) = delete;
+    gc_unsafe_region &operator=(const gc_unsafe_region &) = delete;
+
+    ~gc_unsafe_region()
+    {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        thread_.unsafe_depth_--;
+    }
+
+private:
+    gc_thread_context &thread_;
+};
+
+// Shadow stack frame, registers the reference-holding locals of a method as GC roots
+template <size_t N>
+class gc_frame : public gc_frame_base
+{
+public:
+    template <class... T>
+    gc_frame(T &... values) noexcept
+        : roots_data_ { gc_root { &values, gc_refs_holder<T>::value.data(), (uint32_t)gc_refs_holder<T>::value.size() }... }
+    {
+        auto &thread = gc_current_thread();
+        prev_ = thread.frames_;
+        roots_ = roots_data_.data();
+        roots_count_ = (uint32_t)N;
+        thread.frames_ = this;
+    }
+
+    gc_frame(const gc_frame &) = delete;
+    gc_frame &operator=(const gc_frame &) = delete;
+
+    ~gc_frame()
+    {
+        gc_current_thread().frames_ = prev_;
+    }
+
+private:
+    std::array<gc_root, N> roots_data_;
+};
+
+template <class... T>
+gc_frame<sizeof...(T)> make_gc_frame(T &... values) noexcept
+{
+    return { values... };
+}
+
 template <class T, class U>
 constexpr bool operator==(const gc_obj_ref<T> &lhs, const gc_obj_ref<U> &rhs) noexcept
 {
@@ -726,44 +1116,246 @@ constexpr bool operator>(uintptr_t lhs, const gc_ptr<T> &rhs) noexcept
     return lhs > reinterpret_cast<uintptr_t>(rhs.ptr_);
 }
 
-template <class TBase, class TIFace, bool>
-struct vtable_impl;
+template <class TList, class... TIFaces>
+struct interfaces_append;
 
-template <class TBase, class TIFace>
-struct vtable_impl<TBase, TIFace, true>
+template <class... TIFaces>
+struct interfaces_append<type_list<TIFaces...>>
 {
-    template <class TFunc>
-    constexpr void override_vfunc_impl(std::string_view name, TFunc func)
-    {
-    }
+    using type = type_list<TIFaces...>;
 };
 
-template <class TBase, class TIFace>
-struct vtable_impl<TBase, TIFace, false> : public TIFace
+template <class... TIFaces, class TIFace, class... TRest>
+struct interfaces_append<type_list<TIFaces...>, TIFace, TRest...>
 {
-    template <class TFunc>
-    constexpr void override_vfunc_impl(std::string_view name, TFunc func)
-    {
-        TIFace::override_vfunc_impl(name, func);
-    }
+    using type = typename interfaces_append<std::conditional_t<(std::is_same_v<TIFace, TIFaces> || ...), type_list<TIFaces...>, type_list<TIFaces..., TIFace>>, TRest...>::type;
 };
 
-template <class TBase, class TIFace>
-using vtable_impl_t = vtable_impl<TBase, TIFace, std::is_base_of_v<TIFace, TBase>>;
+template <class TIFace, class TIFaces>
+struct has_interface;
+
+template <class TIFace, class... TIFaces>
+struct has_interface<TIFace, type_list<TIFaces...>> : std::bool_constant<(std::is_same_v<TIFace, TIFaces> || ...)>
+{
+};
 
+// Interface vtables live apart from the class vtable, see vtable_itable
 template <class TBase, class... TIFaces>
-struct vtable_class : public TBase, public vtable_impl_t<TBase, TIFaces>...
+struct vtable_class : public TBase
 {
+    using parent_vtable_t = TBase;
+    using interfaces_t = typename interfaces_append<typename TBase::interfaces_t, TIFaces...>::type;
+
     template <class TFunc>
     constexpr void override_vfunc(std::string_view name, TFunc func)
     {
         TBase::override_vfunc_impl(name, func);
         if constexpr (!std::is_same_v<TBase, clr_vtable>)
             TBase::override_vfunc(name, func);
-        int ignore[] = { 0, (vtable_impl_t<TBase, TIFaces>::override_vfunc_impl(name, func), 0)... };
     }
 };
 
+template <class TFromVTable, class TToVTable>
+constexpr bool is_vtable_convertible() noexcept
+{
+    if constexpr (std::is_base_of_v<clr_vtable, TFromVTable> && !std::is_base_of_v<clr_vtable, TToVTable>)
+        return has_interface<TToVTable, typename TFromVTable::interfaces_t>::value;
+    else
+        return std::is_convertible_v<const TFromVTable *, const TToVTable *>;
+}
+
+// The vtable of TIFace as implemented by TVTable, every class from System.Object down overrides its slots in turn
+template <class TVTable, class TIFace>
+struct vtable_itable
+{
+    static constexpr TIFace make() noexcept
+    {
+        TIFace itable;
+        TVTable::override_itable(itable);
+        return itable;
+    }
+
+    static constexpr TIFace value = make();
+};
+
+template <class TVTable, class TIFace>
+constexpr const TIFace *itable_of() noexcept
+{
+    using parent_t = typename TVTable::parent_vtable_t;
+    if constexpr (!std::is_same_v<parent_t, clr_vtable>)
+    {
+        if constexpr (has_interface<TIFace, typename parent_t::interfaces_t>::value)
+        {
+            if (vtable_itable<TVTable, TIFace>::value == vtable_itable<parent_t, TIFace>::value)
+                return itable_of<parent_t, TIFace>();
+        }
+    }
+
+    return &vtable_itable<TVTable, TIFace>::value;
+}
+
+template <class TVTable, class TParent = typename TVTable::parent_vtable_t>
+struct vtable_display
+{
+    static constexpr uint32_t depth = vtable_display<TParent>::depth + 1;
+
+    template <size_t... I>
+    static constexpr std::array<const void *, depth + 1> make(std::index_sequence<I...>) noexcept
+    {
+        return { vtable_display<TParent>::value[I]..., &vtable_id<TVTable>::value };
+    }
+
+    static constexpr std::array<const void *, depth + 1> value = make(std::make_index_sequence<depth>());
+};
+
+template <class TVTable>
+struct vtable_display<TVTable, clr_vtable>
+{
+    static constexpr uint32_t depth = 0;
+    static constexpr std::array<const void *, 1> value = { &vtable_id<TVTable>::value };
+};
+
+template <size_t N>
+struct interface_layout
+{
+    uint32_t size;
+    uint32_t probes;
+    std::array<uint32_t, N> slots;
+};
+
+template <size_t N>
+constexpr interface_layout<N> place_interfaces(const std::array<uint32_t, N> &ids, uint32_t size) noexcept
+{
+    interface_layout<N> layout { size, 0, {} };
+    std::array<bool, N * 4> used {};
+    for (size_t i = 0; i < N; i++)
+    {
+        uint32_t probes = 1;
+        auto slot = ids[i] & (size - 1);
+        while (used[slot])
+        {
+            slot = (slot + 1) & (size - 1);
+            probes++;
+        }
+
+        used[slot] = true;
+        layout.slots[i] = slot;
+        if (probes > layout.probes)
+            layout.probes = probes;
+    }
+
+    return layout;
+}
+
+// Takes the smallest power of two table, or twice that when it shortens the longest probe
+template <size_t N>
+constexpr interface_layout<N> make_interface_layout(const std::array<uint32_t, N> &ids) noexcept
+{
+    if constexpr (N == 0)
+    {
+        return { 0, 0, {} };
+    }
+    else
+    {
+        uint32_t size = 1;
+        while (size < N)
+            size <<= 1;
+        auto dense = place_interfaces(ids, size);
+        auto sparse = place_interfaces(ids, size * 2);
+        return sparse.probes < dense.probes ? sparse : dense;
+    }
+}
+
+template <class TVTable, class TIFaces = typename TVTable::interfaces_t>
+struct vtable_interfaces;
+
+template <class TVTable, class... TIFaces>
+struct vtable_interfaces<TVTable, type_list<TIFaces...>>
+{
+    static constexpr auto layout = make_interface_layout<sizeof...(TIFaces)>({ TIFaces::InterfaceId... });
+
+    static constexpr clr_interface_entry entry(uint32_t slot) noexcept
+    {
+        constexpr std::array<clr_interface_entry, sizeof...(TIFaces)> entries = {
+            clr_interface_entry { &vtable_id<TIFaces>::value, itable_of<TVTable, TIFaces>() }...
+        };
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (layout.slots[i] == slot)
+                return entries[i];
+        }
+
+        return { nullptr, nullptr };
+    }
+
+    template <size_t... I>
+    static constexpr std::array<clr_interface_entry, sizeof...(I)> make(std::index_sequence<I...>) noexcept
+    {
+        return { entry((uint32_t)I)... };
+    }
+
+    static constexpr auto value = make(std::make_index_sequence<layout.size>());
+};
+
+// Called by the constructor of every class vtable, derived constructors run last and overwrite their bases
+template <class TVTable>
+constexpr void init_type_hierarchy(TVTable &vtable) noexcept
+{
+    vtable.AllocStats = &vtable_alloc_stats<TVTable>::value;
+    vtable.ClassDepth = vtable_display<TVTable>::depth;
+    vtable.ClassDisplay = vtable_display<TVTable>::value.data();
+    if constexpr (vtable_interfaces<TVTable>::layout.size != 0)
+    {
+        vtable.InterfacesMask = (uint16_t)(vtable_interfaces<TVTable>::layout.size - 1);
+        vtable.InterfacesProbes = (uint16_t)vtable_interfaces<TVTable>::layout.probes;
+        vtable.Interfaces = vtable_interfaces<TVTable>::value.data();
+    }
+}
+
+// Probes at most InterfacesProbes slots from the home slot of the id, the map is built so no entry lies further
+inline const clr_interface_entry *find_interface(const clr_vtable &vtable, const void *id, uint32_t hash) noexcept
+{
+    for (uint32_t i = 0; i < vtable.InterfacesProbes; i++)
+    {
+        auto &entry = vtable.Interfaces[(hash + i) & vtable.InterfacesMask];
+        if (entry.Id == id)
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+template <class TVTable>
+const TVTable *object_header::vtable_as() const noexcept
+{
+    if constexpr (std::is_base_of_v<clr_vtable, TVTable>)
+    {
+        // A class is found at its own depth in the display of every type derived from it
+        constexpr auto depth = vtable_display<TVTable>::depth;
+        if (vtable_->ClassDepth >= depth && vtable_->ClassDisplay[depth] == &vtable_id<TVTable>::value)
+            return static_cast<const TVTable *>(vtable_);
+    }
+    else
+    {
+        if (auto entry = find_interface(*vtable_, &vtable_id<TVTable>::value, TVTable::InterfaceId))
+            return static_cast<const TVTable *>(entry->VTable);
+    }
+
+    return nullptr;
+}
+
+// Interface call on an object known to implement TIFace. The home slot is a constant per call site and holds the
+// interface unless an earlier one collided with it, so the map is only probed for collided interfaces
+template <class TIFace>
+const TIFace *object_header::interface_vtable() const noexcept
+{
+    auto &entry = vtable_->Interfaces[TIFace::InterfaceId & vtable_->InterfacesMask];
+    if (entry.Id == &vtable_id<TIFace>::value)
+        return static_cast<const TIFace *>(entry.VTable);
+    return static_cast<const TIFace *>(find_interface(*vtable_, &vtable_id<TIFace>::value, TIFace::InterfaceId)->VTable);
+}
+
 template <size_t N>
 struct string_literal
 {
@@ -827,6 +1419,32 @@ struct static_object
     }
 };
 
+// Storage of an object that does not escape the method allocating it, zeroed so its frame can root it before use.
+// Larger objects are still allocated on the heap, thread stacks are small.
+inline constexpr size_t stack_object_max_size = 128;
+
+template <class T, bool = (sizeof(T) <= stack_object_max_size)>
+struct stack_object
+{
+    alignas(object_header) uint8_t header_[sizeof(object_header)];
+    alignas(T) uint8_t value_[sizeof(T)];
+};
+
+template <class T>
+struct stack_object<T, false>
+{
+};
+
+template <class T>
+struct gc_refs_of<stack_object<T, true>>
+{
+    static constexpr auto get() noexcept
+    {
+        static_assert(offsetof(stack_object<T>, value_) == sizeof(object_header), "Object must follow its header.");
+        return gc_field_refs<T>(sizeof(object_header));
+    }
+};
+
 template <size_t N>
 constexpr auto make_string_literal(const char16_t (&str)[N])
 {
@@ -1050,6 +1668,15 @@ struct runtime_type_holder
         else                                                                    \
             ::natsu::throw_index_out_of_range_exception();                      \
     }                                                                           \
+    constexpr ::natsu::variable_type_t<T> &at_unchecked(size_t index) noexcept  \
+    {                                                                           \
+        return elements_[index];                                                \
+    }                                                                           \
+    constexpr ::natsu::gc_ref<::natsu::variable_type_t<T>>                      \
+    ref_at_unchecked(size_t index) noexcept                                     \
+    {                                                                           \
+        return elements_[index];                                                \
+    }                                                                           \
     constexpr ::natsu::variable_type_t<T> get(int index)                        \
     {                                                                           \
         return at(index);                                                       \
@@ -0,0 +1,120 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Linq;
+
+namespace Natsu.AllocSymbolizer
+{
+    /// <summary>
+    /// Symbolizes an allocation sample dump of the shell allocprof command.
+    /// Symbols are read from "nm -n -C" output of the kernel image, so call sites
+    /// resolve to the generated C++ methods and types to their vtable_holder.
+    /// </summary>
+    class Program
+    {
+        private class Symbol
+        {
+            public ulong Address;
+            public string Name;
+        }
+
+        private class Site
+        {
+            public string Name;
+            public int Samples;
+            public long Bytes;
+            public Dictionary<string, int> Types = new Dictionary<string, int>();
+        }
+
+        static int Main(string[] args)
+        {
+            if (args.Length != 2)
+            {
+                Console.WriteLine("usage: Natsu.AllocSymbolizer <nm -n -C output> <allocprof dump>");
+                return 1;
+            }
+
+            var symbols = LoadSymbols(args[0]);
+            var sites = new Dictionary<string, Site>();
+            int interval = 0;
+
+            foreach (var line in File.ReadLines(args[1]))
+            {
+                var text = line.Trim();
+                if (text.StartsWith("# natsu allocation samples, interval "))
+                {
+                    interval = int.Parse(text.Substring(text.LastIndexOf(' ') + 1));
+                    sites.Clear();
+                    continue;
+                }
+
+                var fields = text.Split(' ', StringSplitOptions.RemoveEmptyEntries);
+                if (fields.Length != 3
+                    || !ulong.TryParse(fields[0], NumberStyles.HexNumber, null, out var callSite)
+                    || !ulong.TryParse(fields[1], NumberStyles.HexNumber, null, out var vtable)
+                    || !int.TryParse(fields[2], out var size))
+                    continue;
+
+                var name = Resolve(symbols, callSite);
+                if (!sites.TryGetValue(name, out var site))
+                    sites.Add(name, site = new Site { Name = name });
+
+                // A sample stands for the interval of bytes it ended
+                site.Samples++;
+                site.Bytes += Math.Max(size, interval);
+                var type = Resolve(symbols, vtable);
+                site.Types[type] = site.Types.GetValueOrDefault(type) + 1;
+            }
+
+            var total = sites.Values.Sum(x => x.Bytes);
+            foreach (var site in sites.Values.OrderByDescending(x => x.Bytes))
+            {
+                Console.WriteLine($"{site.Bytes,12} {(total == 0 ? 0 : site.Bytes * 100.0 / total),6:F2}% {site.Samples,6} {site.Name}");
+                foreach (var type in site.Types.OrderByDescending(x => x.Value))
+                    Console.WriteLine($"{string.Empty,27} {type.Value,6} {type.Key}");
+            }
+
+            return 0;
+        }
+
+        private static List<Symbol> LoadSymbols(string path)
+        {
+            var symbols = new List<Symbol>();
+            foreach (var line in File.ReadLines(path))
+            {
+                var fields = line.Split(' ', 3);
+                if (fields.Length == 3 && fields[1].Length == 1
+                    && ulong.TryParse(fields[0], NumberStyles.HexNumber, null, out var address))
+                    symbols.Add(new Symbol { Address = address, Name = fields[2] });
+            }
+
+            symbols.Sort((x, y) => x.Address.CompareTo(y.Address));
+            return symbols;
+        }
+
+        private static string Resolve(List<Symbol> symbols, ulong address)
+        {
+            int low = 0, high = symbols.Count - 1, found = -1;
+            while (low <= high)
+            {
+                var mid = (low + high) / 2;
+                if (symbols[mid].Address <= address)
+                {
+                    found = mid;
+                    low = mid + 1;
+                }
+                else
+                {
+                    high = mid - 1;
+                }
+            }
+
+            if (found == -1)
+                return $"0x{address:X}";
+
+            var symbol = symbols[found];
+            return address == symbol.Address ? symbol.Name : $"{symbol.Name}+0x{address - symbol.Address:X}";
+        }
+    }
+}
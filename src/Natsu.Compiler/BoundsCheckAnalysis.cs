@@ -0,0 +1,334 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace Natsu.Compiler
+{
+    // Range analysis, finds array accesses whose index is a local known to be in [0, array.Length)
+    static class BoundsCheckAnalysis
+    {
+        private class State
+        {
+            // Facts "i:a" mean local i is less than the length of array variable a
+            public HashSet<string> Facts { get; }
+
+            // What each stack slot holds, a variable, len:a, lt:i:a or null if unknown
+            public List<string> Stack { get; }
+
+            public State(HashSet<string> facts, List<string> stack)
+            {
+                Facts = facts;
+                Stack = stack;
+            }
+        }
+
+        public static HashSet<Instruction> FindUncheckedAccesses(MethodDef method)
+        {
+            var result = new HashSet<Instruction>();
+            if (!method.HasBody || !method.Body.Instructions.Any(IsElementAccess))
+                return result;
+
+            var states = Analyze(method);
+            if (states == null)
+                return result;
+
+            var instructions = method.Body.Instructions;
+            foreach (var inst in instructions)
+            {
+                if (IsElementAccess(inst) && states.TryGetValue(inst, out var state))
+                {
+                    // Stores have the value above the index
+                    var depth = inst.OpCode.Name.StartsWith("stelem") ? 1 : 0;
+                    var stack = state.Stack;
+                    var index = stack[stack.Count - 1 - depth];
+                    var array = stack[stack.Count - 2 - depth];
+                    if (index != null && array != null && state.Facts.Contains(index + ":" + array)
+                        && IsNonNegative(method, states, index))
+                        result.Add(inst);
+                }
+            }
+
+            return result;
+        }
+
+        private static bool IsElementAccess(Instruction inst)
+        {
+            switch (inst.OpCode.Code)
+            {
+                case Code.Ldelem:
+                case Code.Ldelem_I:
+                case Code.Ldelem_I1:
+                case Code.Ldelem_I2:
+                case Code.Ldelem_I4:
+                case Code.Ldelem_I8:
+                case Code.Ldelem_R4:
+                case Code.Ldelem_R8:
+                case Code.Ldelem_Ref:
+                case Code.Ldelem_U1:
+                case Code.Ldelem_U2:
+                case Code.Ldelem_U4:
+                case Code.Ldelema:
+                case Code.Stelem:
+                case Code.Stelem_I:
+                case Code.Stelem_I1:
+                case Code.Stelem_I2:
+                case Code.Stelem_I4:
+                case Code.Stelem_I8:
+                case Code.Stelem_R4:
+                case Code.Stelem_R8:
+                case Code.Stelem_Ref:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // An index local stays non-negative if it starts at a non-negative constant and is only incremented below a length
+        private static bool IsNonNegative(MethodDef method, Dictionary<Instruction, State> states, string local)
+        {
+            var body = method.Body;
+            var instructions = body.Instructions;
+            var variable = body.Variables[int.Parse(local.Substring(1))];
+            if (variable.Type.ElementType != ElementType.I4)
+                return false;
+
+            for (int i = 0; i < instructions.Count; i++)
+            {
+                var inst = instructions[i];
+                if (!inst.IsStloc() || inst.GetLocal(body.Variables) != variable)
+                    continue;
+
+                if (i >= 1 && instructions[i - 1].IsLdcI4() && instructions[i - 1].GetLdcI4Value() >= 0)
+                    continue;
+
+                if (i >= 3 && instructions[i - 1].OpCode.Code == Code.Add
+                    && instructions[i - 2].IsLdcI4() && instructions[i - 2].GetLdcI4Value() == 1
+                    && instructions[i - 3].IsLdloc() && instructions[i - 3].GetLocal(body.Variables) == variable
+                    && states.TryGetValue(instructions[i - 3], out var state)
+                    && state.Facts.Any(x => x.StartsWith(local + ":")))
+                    continue;
+
+                return false;
+            }
+
+            return true;
+        }
+
+        private static Dictionary<Instruction, State> Analyze(MethodDef method)
+        {
+            var body = method.Body;
+            var instructions = body.Instructions;
+            var hasReturnValue = method.ReturnType.ElementType != ElementType.Void;
+            var addressTaken = new HashSet<string>();
+            foreach (var inst in instructions)
+            {
+                if (inst.OpCode.Code == Code.Ldloca || inst.OpCode.Code == Code.Ldloca_S)
+                    addressTaken.Add("l" + inst.GetLocal(body.Variables).Index);
+                else if (inst.OpCode.Code == Code.Ldarga || inst.OpCode.Code == Code.Ldarga_S)
+                    addressTaken.Add("a" + inst.GetParameterIndex());
+            }
+
+            var states = new Dictionary<Instruction, State>();
+            var pending = new Stack<Instruction>();
+            bool consistent = true;
+
+            void Flow(Instruction target, HashSet<string> facts, List<string> stack)
+            {
+                if (!states.TryGetValue(target, out var state))
+                {
+                    states.Add(target, new State(new HashSet<string>(facts), new List<string>(stack)));
+                    pending.Push(target);
+                }
+                else if (state.Stack.Count != stack.Count)
+                {
+                    consistent = false;
+                }
+                else
+                {
+                    var count = state.Facts.Count;
+                    state.Facts.IntersectWith(facts);
+                    bool changed = state.Facts.Count != count;
+                    for (int i = 0; i < stack.Count; i++)
+                    {
+                        if (state.Stack[i] != null && state.Stack[i] != stack[i])
+                        {
+                            state.Stack[i] = null;
+                            changed = true;
+                        }
+                    }
+
+                    if (changed)
+                        pending.Push(target);
+                }
+            }
+
+            if (instructions.Count != 0)
+                Flow(instructions[0], new HashSet<string>(), new List<string>());
+            foreach (var handler in body.ExceptionHandlers)
+            {
+                var entry = new List<string>();
+                if (handler.HandlerType == ExceptionHandlerType.Catch || handler.HandlerType == ExceptionHandlerType.Filter)
+                    entry.Add(null);
+                Flow(handler.HandlerStart, new HashSet<string>(), entry);
+                if (handler.FilterStart != null)
+                    Flow(handler.FilterStart, new HashSet<string>(), entry);
+            }
+
+            while (pending.Count != 0 && consistent)
+            {
+                var inst = pending.Pop();
+                var state = states[inst];
+                var facts = new HashSet<string>(state.Facts);
+                var stack = new List<string>(state.Stack);
+                string taken = null, fallthrough = null;
+
+                string Pop()
+                {
+                    var value = stack[stack.Count - 1];
+                    stack.RemoveAt(stack.Count - 1);
+                    return value;
+                }
+
+                void Kill(string variable)
+                {
+                    facts.RemoveWhere(x => x.Split(':').Contains(variable));
+                    for (int i = 0; i < stack.Count; i++)
+                    {
+                        if (stack[i] != null && stack[i].Split(':').Contains(variable))
+                            stack[i] = null;
+                    }
+                }
+
+                string Variable(string name)
+                {
+                    return addressTaken.Contains(name) ? null : name;
+                }
+
+                // The fact an in-range compare of x and y proves, x is the index
+                string Compare(string index, string length)
+                {
+                    return index != null && index[0] == 'l' && length != null && length.StartsWith("len:")
+                        ? index + ":" + length.Substring(4) : null;
+                }
+
+                inst.CalculateStackUsage(hasReturnValue, out var pushes, out var pops);
+                var code = inst.OpCode.Code;
+                if (inst.IsLdloc())
+                {
+                    stack.Add(Variable("l" + inst.GetLocal(body.Variables).Index));
+                }
+                else if (inst.IsLdarg())
+                {
+                    stack.Add(Variable("a" + inst.GetParameterIndex()));
+                }
+                else if (inst.IsStloc())
+                {
+                    Pop();
+                    Kill("l" + inst.GetLocal(body.Variables).Index);
+                }
+                else if (inst.IsStarg())
+                {
+                    Pop();
+                    Kill("a" + inst.GetParameterIndex());
+                }
+                else if (code == Code.Dup)
+                {
+                    stack.Add(stack[stack.Count - 1]);
+                }
+                else if (code == Code.Ldlen)
+                {
+                    var array = Pop();
+                    stack.Add(array != null ? "len:" + array : null);
+                }
+                else if (code == Code.Conv_I4 || code == Code.Conv_I || code == Code.Conv_U || code == Code.Conv_I8 || code == Code.Conv_U8)
+                {
+                    var value = Pop();
+                    stack.Add(value != null && value.StartsWith("len:") ? value : null);
+                }
+                else if (code == Code.Clt || code == Code.Clt_Un || code == Code.Cgt || code == Code.Cgt_Un)
+                {
+                    var y = Pop();
+                    var x = Pop();
+                    var fact = code == Code.Clt || code == Code.Clt_Un ? Compare(x, y) : Compare(y, x);
+                    stack.Add(fact != null ? "lt:" + fact : null);
+                }
+                else if (code == Code.Brtrue || code == Code.Brtrue_S || code == Code.Brfalse || code == Code.Brfalse_S)
+                {
+                    var condition = Pop();
+                    var fact = condition != null && condition.StartsWith("lt:") ? condition.Substring(3) : null;
+                    if (code == Code.Brtrue || code == Code.Brtrue_S)
+                        taken = fact;
+                    else
+                        fallthrough = fact;
+                }
+                else if (code == Code.Blt || code == Code.Blt_S || code == Code.Blt_Un || code == Code.Blt_Un_S
+                    || code == Code.Bge || code == Code.Bge_S || code == Code.Bge_Un || code == Code.Bge_Un_S)
+                {
+                    var y = Pop();
+                    var x = Pop();
+                    if (code == Code.Blt || code == Code.Blt_S || code == Code.Blt_Un || code == Code.Blt_Un_S)
+                        taken = Compare(x, y);
+                    else
+                        fallthrough = Compare(x, y);
+                }
+                else if (code == Code.Bgt || code == Code.Bgt_S || code == Code.Bgt_Un || code == Code.Bgt_Un_S
+                    || code == Code.Ble || code == Code.Ble_S || code == Code.Ble_Un || code == Code.Ble_Un_S)
+                {
+                    var y = Pop();
+                    var x = Pop();
+                    if (code == Code.Bgt || code == Code.Bgt_S || code == Code.Bgt_Un || code == Code.Bgt_Un_S)
+                        taken = Compare(y, x);
+                    else
+                        fallthrough = Compare(y, x);
+                }
+                else if (pops == -1)
+                {
+                    stack.Clear();
+                }
+                else
+                {
+                    stack.RemoveRange(stack.Count - pops, pops);
+                    for (int i = 0; i < pushes; i++)
+                        stack.Add(null);
+                }
+
+                HashSet<string> With(string fact)
+                {
+                    if (fact == null)
+                        return facts;
+                    return new HashSet<string>(facts) { fact };
+                }
+
+                switch (inst.OpCode.FlowControl)
+                {
+                    case FlowControl.Branch:
+                        Flow((Instruction)inst.Operand, facts, stack);
+                        continue;
+                    case FlowControl.Cond_Branch:
+                        if (inst.Operand is IList<Instruction> targets)
+                        {
+                            foreach (var target in targets)
+                                Flow(target, facts, stack);
+                        }
+                        else
+                        {
+                            Flow((Instruction)inst.Operand, With(taken), stack);
+                        }
+                        break;
+                    case FlowControl.Return:
+                    case FlowControl.Throw:
+                        continue;
+                }
+
+                var index = instructions.IndexOf(inst);
+                if (index < instructions.Count - 1)
+                    Flow(instructions[index + 1], With(fallthrough), stack);
+            }
+
+            return consistent ? states : null;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+
+namespace Natsu.Compiler
+{
+    // Class hierarchy analysis over the closed world of compiled modules, binds virtual calls that have a single target
+    static class ClassHierarchy
+    {
+        private static readonly Dictionary<TypeDef, List<TypeDef>> _derivedTypes = new Dictionary<TypeDef, List<TypeDef>>();
+        private static readonly ConcurrentDictionary<MethodDef, MethodDef> _targets = new ConcurrentDictionary<MethodDef, MethodDef>();
+
+        public static void AddModule(ModuleDef module)
+        {
+            foreach (var type in module.GetTypes())
+            {
+                var baseType = type.BaseType?.ResolveTypeDef();
+                if (baseType == null)
+                    continue;
+
+                if (!_derivedTypes.TryGetValue(baseType, out var derived))
+                    _derivedTypes.Add(baseType, derived = new List<TypeDef>());
+                derived.Add(type);
+            }
+        }
+
+        // Returns the only method a callvirt can reach, or null if the call must stay virtual
+        public static MethodDef FindSingleTarget(MethodDef method)
+        {
+            if (!method.IsVirtual)
+                return method;
+            if (method.DeclaringType.IsInterface)
+                return null;
+            if (method.IsFinal || method.DeclaringType.IsSealed)
+                return method.IsAbstract ? null : method;
+
+            return _targets.GetOrAdd(method, FindSingleTargetCore);
+        }
+
+        private static MethodDef FindSingleTargetCore(MethodDef method)
+        {
+            MethodDef target = null;
+            var pending = new Stack<TypeDef>();
+            pending.Push(method.DeclaringType);
+            while (pending.Count != 0)
+            {
+                var type = pending.Pop();
+                if (!type.IsAbstract)
+                {
+                    if (!TryResolveOverride(type, method, out var impl) || impl.IsAbstract)
+                        return null;
+                    if (target != null && target != impl)
+                        return null;
+                    target = impl;
+                }
+
+                if (!type.IsSealed && _derivedTypes.TryGetValue(type, out var derived))
+                {
+                    foreach (var derivedType in derived)
+                        pending.Push(derivedType);
+                }
+            }
+
+            return target;
+        }
+
+        private static bool TryResolveOverride(TypeDef type, MethodDef method, out MethodDef impl)
+        {
+            var comparer = new SigComparer();
+            for (var cntType = type; cntType != null; cntType = cntType.BaseType?.ResolveTypeDef())
+            {
+                foreach (var candidate in cntType.Methods)
+                {
+                    if (candidate == method || candidate.Overrides.Any(x => x.MethodDeclaration.ResolveMethodDef() == method))
+                    {
+                        impl = candidate;
+                        return true;
+                    }
+
+                    if (candidate.IsVirtual && !candidate.IsNewSlot && candidate.Name == method.Name
+                        && candidate.Parameters.Count == method.Parameters.Count)
+                    {
+                        if (comparer.Equals(candidate.MethodSig, method.MethodSig))
+                        {
+                            impl = candidate;
+                            return true;
+                        }
+
+                        // Signatures over generic arguments of a base type don't compare, it may be an override
+                        if (cntType.BaseType is TypeSpec || method.DeclaringType.HasGenericParameters)
+                        {
+                            impl = null;
+                            return false;
+                        }
+                    }
+                }
+
+                if (cntType == method.DeclaringType)
+                    break;
+            }
+
+            impl = null;
+            return false;
+        }
+    }
+}
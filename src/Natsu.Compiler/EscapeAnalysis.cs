@@ -0,0 +1,395 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace Natsu.Compiler
+{
+    // Intra-procedural escape analysis, finds newobj sites whose object never outlives the method
+    static class EscapeAnalysis
+    {
+        private const int ThisValue = -1;
+        private const int MaxSummaryDepth = 8;
+
+        private static readonly ConcurrentDictionary<MethodDef, bool> _thisEscapes = new ConcurrentDictionary<MethodDef, bool>();
+        private static readonly ConcurrentDictionary<MethodDef, HashSet<Instruction>> _stackAllocations = new ConcurrentDictionary<MethodDef, HashSet<Instruction>>();
+
+        [ThreadStatic]
+        private static HashSet<MethodDef> _summarizing;
+
+        // Summaries depend on the order methods are analyzed in, so every method is analyzed up front in module order,
+        // code generation running in parallel then only reads the results
+        public static void AnalyzeModules(IEnumerable<ModuleDef> modules)
+        {
+            foreach (var module in modules)
+            {
+                foreach (var type in module.GetTypes())
+                {
+                    foreach (var method in type.Methods)
+                        FindStackAllocations(method);
+                }
+            }
+        }
+
+        public static HashSet<Instruction> FindStackAllocations(MethodDef method)
+        {
+            return _stackAllocations.GetOrAdd(method, FindStackAllocationsCore);
+        }
+
+        private static HashSet<Instruction> FindStackAllocationsCore(MethodDef method)
+        {
+            var result = new HashSet<Instruction>();
+            if (!method.HasBody)
+                return result;
+
+            var instructions = method.Body.Instructions;
+            var sites = new Dictionary<Instruction, int>();
+            foreach (var inst in instructions)
+            {
+                if (inst.OpCode.Code == Code.Newobj && IsStackAllocatable((IMethod)inst.Operand, 0)
+                    && !InHandler(method, inst) && !InLoop(method, inst))
+                    sites.Add(inst, sites.Count);
+            }
+
+            if (sites.Count == 0)
+                return result;
+
+            var escaped = Analyze(method, sites, false, 0);
+            foreach (var site in sites)
+            {
+                if (!escaped.Contains(site.Value))
+                    result.Add(site.Key);
+            }
+
+            return result;
+        }
+
+        private static bool IsStackAllocatable(IMethod ctor, int depth)
+        {
+            var type = ctor.DeclaringType.ResolveTypeDef();
+            if (type == null || type.IsValueType || type.IsDelegate || type.IsAbstract
+                || (type.Namespace == "System" && type.Name == "String"))
+                return false;
+
+            var ctorDef = ctor.ResolveMethodDef();
+            return ctorDef != null && !ThisEscapes(ctorDef, depth);
+        }
+
+        // A method lets this escape unless every use of it is a field access or a call that keeps it too
+        private static bool ThisEscapes(MethodDef method, int depth)
+        {
+            if (!method.HasBody || method.IsStatic || depth > MaxSummaryDepth)
+                return true;
+
+            if (_thisEscapes.TryGetValue(method, out var escapes))
+                return escapes;
+
+            // Recursive calls are assumed to escape
+            _summarizing ??= new HashSet<MethodDef>();
+            if (!_summarizing.Add(method))
+                return true;
+
+            escapes = Analyze(method, null, true, depth).Contains(ThisValue);
+            _summarizing.Remove(method);
+            _thisEscapes.TryAdd(method, escapes);
+            return escapes;
+        }
+
+        private static bool InHandler(MethodDef method, Instruction inst)
+        {
+            return method.Body.ExceptionHandlers.Any(x => inst.Offset >= x.HandlerStart.Offset
+                && (x.HandlerEnd == null || inst.Offset < x.HandlerEnd.Offset));
+        }
+
+        // Objects allocated in a loop would share the storage of a single site
+        private static bool InLoop(MethodDef method, Instruction site)
+        {
+            var visited = new HashSet<Instruction>();
+            var pending = new Stack<Instruction>(Successors(method, site));
+            while (pending.Count != 0)
+            {
+                var inst = pending.Pop();
+                if (inst == site)
+                    return true;
+                if (visited.Add(inst))
+                {
+                    foreach (var next in Successors(method, inst))
+                        pending.Push(next);
+                }
+            }
+
+            return false;
+        }
+
+        private static IEnumerable<Instruction> Successors(MethodDef method, Instruction inst)
+        {
+            var instructions = method.Body.Instructions;
+            switch (inst.OpCode.FlowControl)
+            {
+                case FlowControl.Branch:
+                    yield return (Instruction)inst.Operand;
+                    yield break;
+                case FlowControl.Cond_Branch:
+                    if (inst.Operand is IList<Instruction> targets)
+                    {
+                        foreach (var target in targets)
+                            yield return target;
+                    }
+                    else
+                    {
+                        yield return (Instruction)inst.Operand;
+                    }
+                    break;
+                case FlowControl.Return:
+                case FlowControl.Throw:
+                    yield break;
+            }
+
+            var index = instructions.IndexOf(inst);
+            if (index < instructions.Count - 1)
+                yield return instructions[index + 1];
+        }
+
+        // Returns the tracked values that escape, the values are newobj site ids or this
+        private static HashSet<int> Analyze(MethodDef method, Dictionary<Instruction, int> sites, bool trackThis, int depth)
+        {
+            var body = method.Body;
+            var instructions = body.Instructions;
+            var hasReturnValue = method.ReturnType.ElementType != ElementType.Void;
+            var escaped = new HashSet<int>();
+            var locals = new Dictionary<int, HashSet<int>>();
+            var addressTaken = new HashSet<int>();
+            var siteTypes = sites?.ToDictionary(x => x.Value, x => ((IMethod)x.Key.Operand).DeclaringType.ResolveTypeDef());
+
+            if (trackThis && instructions.Any(x => (x.IsStarg() || x.OpCode.Code == Code.Ldarga || x.OpCode.Code == Code.Ldarga_S) && x.GetParameterIndex() == 0))
+                escaped.Add(ThisValue);
+
+            void Escape(List<HashSet<int>> values)
+            {
+                foreach (var value in values)
+                    escaped.UnionWith(value);
+            }
+
+            bool changed = true;
+            while (changed)
+            {
+                var lastEscaped = escaped.Count;
+                var lastLocals = locals.Sum(x => x.Value.Count) + addressTaken.Count;
+                var states = new Dictionary<Instruction, List<HashSet<int>>>();
+                var pending = new Stack<Instruction>();
+
+                void Flow(Instruction target, List<HashSet<int>> stack)
+                {
+                    if (!states.TryGetValue(target, out var state))
+                    {
+                        states.Add(target, stack.Select(x => new HashSet<int>(x)).ToList());
+                        pending.Push(target);
+                    }
+                    else if (state.Count != stack.Count)
+                    {
+                        // Inconsistent stack depths are not verifiable IL, give up on the method
+                        Escape(stack);
+                        Escape(state);
+                        if (trackThis)
+                            escaped.Add(ThisValue);
+                        if (sites != null)
+                            escaped.UnionWith(sites.Values);
+                    }
+                    else
+                    {
+                        bool grown = false;
+                        for (int i = 0; i < stack.Count; i++)
+                        {
+                            var count = state[i].Count;
+                            state[i].UnionWith(stack[i]);
+                            grown |= state[i].Count != count;
+                        }
+
+                        if (grown)
+                            pending.Push(target);
+                    }
+                }
+
+                if (instructions.Count != 0)
+                    Flow(instructions[0], new List<HashSet<int>>());
+                foreach (var handler in body.ExceptionHandlers)
+                {
+                    var entry = new List<HashSet<int>>();
+                    if (handler.HandlerType == ExceptionHandlerType.Catch || handler.HandlerType == ExceptionHandlerType.Filter)
+                        entry.Add(new HashSet<int>());
+                    Flow(handler.HandlerStart, entry);
+                    if (handler.FilterStart != null)
+                        Flow(handler.FilterStart, entry);
+                }
+
+                while (pending.Count != 0)
+                {
+                    var inst = pending.Pop();
+                    var stack = states[inst].Select(x => new HashSet<int>(x)).ToList();
+                    HashSet<int> Pop()
+                    {
+                        var value = stack[stack.Count - 1];
+                        stack.RemoveAt(stack.Count - 1);
+                        return value;
+                    }
+
+                    List<HashSet<int>> PopMany(int count)
+                    {
+                        var values = stack.GetRange(stack.Count - count, count);
+                        stack.RemoveRange(stack.Count - count, count);
+                        return values;
+                    }
+
+                    inst.CalculateStackUsage(hasReturnValue, out var pushes, out var pops);
+                    var code = inst.OpCode.Code;
+                    if (inst.IsLdarg())
+                    {
+                        stack.Add(trackThis && inst.GetParameterIndex() == 0 ? new HashSet<int> { ThisValue } : new HashSet<int>());
+                    }
+                    else if (inst.IsLdloc())
+                    {
+                        var index = inst.GetLocal(body.Variables).Index;
+                        stack.Add(locals.TryGetValue(index, out var local) ? new HashSet<int>(local) : new HashSet<int>());
+                    }
+                    else if (inst.IsStloc())
+                    {
+                        var index = inst.GetLocal(body.Variables).Index;
+                        var value = Pop();
+                        if (addressTaken.Contains(index))
+                            escaped.UnionWith(value);
+                        if (!locals.TryGetValue(index, out var local))
+                            locals.Add(index, local = new HashSet<int>());
+                        local.UnionWith(value);
+                    }
+                    else if (code == Code.Ldloca || code == Code.Ldloca_S)
+                    {
+                        var index = inst.GetLocal(body.Variables).Index;
+                        addressTaken.Add(index);
+                        if (locals.TryGetValue(index, out var local))
+                            escaped.UnionWith(local);
+                        stack.Add(new HashSet<int>());
+                    }
+                    else if (code == Code.Dup)
+                    {
+                        stack.Add(new HashSet<int>(stack[stack.Count - 1]));
+                    }
+                    else if (code == Code.Pop)
+                    {
+                        Pop();
+                    }
+                    else if (code == Code.Ldfld)
+                    {
+                        Pop();
+                        stack.Add(new HashSet<int>());
+                    }
+                    else if (code == Code.Stfld)
+                    {
+                        escaped.UnionWith(Pop());
+                        Pop();
+                    }
+                    else if (code == Code.Isinst || code == Code.Castclass)
+                    {
+                        // The same object is pushed back
+                    }
+                    else if (code == Code.Brtrue || code == Code.Brtrue_S || code == Code.Brfalse || code == Code.Brfalse_S)
+                    {
+                        Pop();
+                    }
+                    else if (code == Code.Beq || code == Code.Beq_S || code == Code.Bne_Un || code == Code.Bne_Un_S
+                        || code == Code.Ceq || code == Code.Cgt_Un)
+                    {
+                        PopMany(2);
+                        if (pushes != 0)
+                            stack.Add(new HashSet<int>());
+                    }
+                    else if (code == Code.Newobj && sites != null && sites.TryGetValue(inst, out var site))
+                    {
+                        Escape(PopMany(pops));
+                        stack.Add(new HashSet<int> { site });
+                    }
+                    else if (code == Code.Call || code == Code.Callvirt)
+                    {
+                        var callee = (IMethod)inst.Operand;
+                        var args = PopMany(pops);
+                        var first = 0;
+                        if (callee.MethodSig.HasThis && args.Count != 0)
+                        {
+                            var self = args[0];
+                            if (self.Count != 0 && !CallKeepsThis(callee, code == Code.Callvirt, self, siteTypes, depth))
+                                escaped.UnionWith(self);
+                            first = 1;
+                        }
+
+                        Escape(args.Skip(first).ToList());
+                        if (pushes != 0)
+                            stack.Add(new HashSet<int>());
+                    }
+                    else if (pops == -1)
+                    {
+                        Escape(stack);
+                        stack.Clear();
+                    }
+                    else
+                    {
+                        Escape(PopMany(pops));
+                        for (int i = 0; i < pushes; i++)
+                            stack.Add(new HashSet<int>());
+                    }
+
+                    foreach (var next in Successors(method, inst))
+                        Flow(next, stack);
+                }
+
+                changed = escaped.Count != lastEscaped || locals.Sum(x => x.Value.Count) + addressTaken.Count != lastLocals;
+            }
+
+            return escaped;
+        }
+
+        private static bool CallKeepsThis(IMethod callee, bool isVirtual, HashSet<int> self, Dictionary<int, TypeDef> siteTypes, int depth)
+        {
+            var target = callee.ResolveMethodDef();
+            if (target == null)
+                return false;
+
+            if (!isVirtual || !target.IsVirtual || target.IsFinal || target.DeclaringType.IsSealed)
+                return !ThisEscapes(target, depth + 1);
+
+            // The exact type of an object allocated here is known, so is the override it calls
+            foreach (var value in self)
+            {
+                if (value == ThisValue || siteTypes == null)
+                    return false;
+
+                var method = ResolveOverride(siteTypes[value], target);
+                if (method == null || ThisEscapes(method, depth + 1))
+                    return false;
+            }
+
+            return true;
+        }
+
+        private static MethodDef ResolveOverride(TypeDef type, MethodDef method)
+        {
+            var comparer = new SigComparer();
+            for (var cntType = type; cntType != null; cntType = cntType.BaseType?.ResolveTypeDef())
+            {
+                foreach (var candidate in cntType.Methods)
+                {
+                    if (candidate == method)
+                        return candidate;
+                    if (candidate.IsVirtual && !candidate.IsNewSlot && candidate.Name == method.Name
+                        && comparer.Equals(candidate.MethodSig, method.MethodSig))
+                        return candidate;
+                    if (candidate.Overrides.Any(x => x.MethodDeclaration.ResolveMethodDef() == method))
+                        return candidate;
+                }
+            }
+
+            return null;
+        }
+    }
+}
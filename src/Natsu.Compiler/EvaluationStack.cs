@@ -3,6 +3,7 @@ using System.Collections.Generic;
 using System.IO;
 using System.Linq;
 using System.Text;
+using System.Text.RegularExpressions;
 using dnlib.DotNet;
 
 namespace Natsu.Compiler
@@ -50,6 +51,7 @@ namespace Natsu.Compiler
         private readonly Stack<StackEntry> _stackValues = new Stack<StackEntry>();
         private int _paramIndex = 0;
         private TextWriter _writer;
+        private readonly RootPool _roots;
         public int Ident { get; set; }
         public int ParamIndex => _paramIndex;
 
@@ -68,11 +70,12 @@ namespace Natsu.Compiler
             return value;
         }
 
-        public EvaluationStack(TextWriter writer, int ident, int paramIndex)
+        public EvaluationStack(TextWriter writer, int ident, int paramIndex, RootPool roots)
         {
             _writer = writer;
             Ident = ident;
             _paramIndex = paramIndex;
+            _roots = roots;
         }
 
         public void SetWriter(TextWriter writer)
@@ -103,11 +106,26 @@ namespace Natsu.Compiler
                 _stackValues.Pop();
                 var id = $"_v{_paramIndex++}";
                 _writer.Ident(Ident).WriteLine($"auto {id} = {entry.Expression};");
+                _roots.AddCopy(id, entry.Expression);
                 var newEntry = new StackEntry { Type = entry.Type, Expression = id, Computed = true };
                 _stackValues.Push(newEntry);
             }
         }
 
+        // Materialize a freshly allocated reference into a GC rooted temporary
+        public void Root()
+        {
+            var entry = _stackValues.Peek();
+            if (!entry.Computed && TypeUtils.MayContainGCRefs(entry.Type))
+            {
+                // The entry itself still counts as live, its expression may read a temporary being recycled
+                var newEntry = _roots.Allocate(entry.Type, _stackValues, () => $"_v{_paramIndex++}");
+                _stackValues.Pop();
+                _writer.Ident(Ident).WriteLine($"{newEntry.Expression} = {entry.Expression};");
+                _stackValues.Push(newEntry);
+            }
+        }
+
         public void Dup()
         {
             Compute();
@@ -141,13 +159,63 @@ namespace Natsu.Compiler
 
         public EvaluationStack Clone(int identInc = 0)
         {
-            var stack = new EvaluationStack(_writer, Ident + identInc, _paramIndex);
+            var stack = new EvaluationStack(_writer, Ident + identInc, _paramIndex, _roots);
             foreach (var value in _stackValues.Reverse())
                 stack._stackValues.Push(value);
             return stack;
         }
     }
 
+    // GC rooted temporaries of a method. A temporary is live while a value on the evaluation stack refers to it,
+    // directly or through a computed copy. Values only leave a block through spill slots, so every temporary is
+    // free again when a block starts and frames only grow to the most temporaries live at once.
+    class RootPool
+    {
+        private static readonly Regex _temporary = new Regex(@"\b_v\d+\b");
+        private readonly Dictionary<string, HashSet<string>> _copies = new Dictionary<string, HashSet<string>>();
+
+        public List<StackEntry> Roots { get; } = new List<StackEntry>();
+
+        public StackEntry Allocate(StackType type, IEnumerable<StackEntry> live, Func<string> newName)
+        {
+            var typeName = TypeUtils.EscapeStackTypeName(type);
+            var liveRoots = FindRoots(live.Select(x => x.Expression));
+            var root = Roots.FirstOrDefault(x => TypeUtils.EscapeStackTypeName(x.Type) == typeName && !liveRoots.Contains(x.Expression));
+            if (root == null)
+            {
+                root = new StackEntry { Type = type, Expression = newName(), Computed = true };
+                Roots.Add(root);
+            }
+
+            return new StackEntry { Type = type, Expression = root.Expression, Computed = true };
+        }
+
+        // A computed copy is not rooted itself, it keeps alive the temporaries it was computed from
+        public void AddCopy(string name, string expression)
+        {
+            var roots = FindRoots(new[] { expression });
+            if (roots.Count != 0)
+                _copies.Add(name, roots);
+        }
+
+        private HashSet<string> FindRoots(IEnumerable<string> expressions)
+        {
+            var roots = new HashSet<string>();
+            foreach (var expression in expressions)
+            {
+                foreach (Match match in _temporary.Matches(expression))
+                {
+                    if (_copies.TryGetValue(match.Value, out var copied))
+                        roots.UnionWith(copied);
+                    else
+                        roots.Add(match.Value);
+                }
+            }
+
+            return roots;
+        }
+    }
+
     class SpillSlot
     {
         public int Index { get; set; }
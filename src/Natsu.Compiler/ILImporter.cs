@@ -21,8 +21,13 @@ namespace Natsu.Compiler
         private int _paramIndex;
         private int _blockId;
         private int _nextSpillSlot = 0;
+        private HashSet<Instruction> _stackAllocations = new HashSet<Instruction>();
+        private HashSet<Instruction> _uncheckedAccesses = new HashSet<Instruction>();
+        private HashSet<Instruction> _redundantNullChecks = new HashSet<Instruction>();
+        private List<(string type, string name)> _stackObjects = new List<(string type, string name)>();
 
         public List<string> UserStrings { get; set; }
+        public string UserStringPrefix { get; set; }
         public string ModuleName { get; set; }
 
         public ILImporter(CorLibTypes corLibTypes, MethodDef method, TextWriter writer, int ident)
@@ -170,8 +175,15 @@ namespace Natsu.Compiler
         {
             var visited = new HashSet<BasicBlock>();
             var spills = new List<SpillSlot>();
-            VisitBlock(_ident, _headBlock, visited, spills);
+            var roots = new RootPool();
+            _stackAllocations = EscapeAnalysis.FindStackAllocations(_method);
+            _uncheckedAccesses = BoundsCheckAnalysis.FindUncheckedAccesses(_method);
+            _redundantNullChecks = NullCheckAnalysis.FindRedundantNullChecks(_method);
+            VisitBlock(_ident, _headBlock, visited, spills, roots);
             WriteSpills(spills, _writer, _ident);
+            WriteRoots(roots.Roots, _writer, _ident);
+            WriteStackObjects(_writer, _ident);
+            WriteGCFrame(spills, roots.Roots, _writer, _ident, true);
             visited.Clear();
             VisitBlockText(_headBlock, _writer, visited);
         }
@@ -187,6 +199,49 @@ namespace Natsu.Compiler
             }
         }
 
+        private void WriteRoots(List<StackEntry> roots, TextWriter writer, int ident)
+        {
+            foreach (var root in roots)
+                writer.Ident(ident).WriteLine($"{TypeUtils.EscapeStackTypeName(root.Type)} {root.Expression};");
+        }
+
+        private void WriteStackObjects(TextWriter writer, int ident)
+        {
+            foreach (var stackObject in _stackObjects)
+                writer.Ident(ident).WriteLine($"::natsu::stack_object<{stackObject.type}> {stackObject.name} {{}};");
+        }
+
+        private void WriteGCFrame(List<SpillSlot> spills, List<StackEntry> roots, TextWriter writer, int ident, bool hasLocals)
+        {
+            var names = new List<string>();
+            if (hasLocals)
+            {
+                foreach (var param in _method.Parameters)
+                {
+                    if (TypeUtils.MayContainGCRefs(param.Type))
+                        names.Add(param.IsHiddenThisParameter ? "_this" : param.ToString());
+                }
+
+                foreach (var local in _method.Body.Variables)
+                {
+                    if (TypeUtils.MayContainGCRefs(local.Type))
+                        names.Add(TypeUtils.GetLocalName(local, _method));
+                }
+
+                names.AddRange(_stackObjects.Select(x => x.name));
+            }
+
+            foreach (var spill in spills)
+            {
+                if (TypeUtils.MayContainGCRefs(spill.Entry.Type) && !names.Contains(spill.Name))
+                    names.Add(spill.Name);
+            }
+
+            names.AddRange(roots.Select(x => x.Expression));
+            if (names.Any())
+                writer.Ident(ident).WriteLine($"auto _gc_frame = ::natsu::make_gc_frame({string.Join(", ", names)});");
+        }
+
         private void VisitBlockText(BasicBlock block, TextWriter writer, HashSet<BasicBlock> visited)
         {
             var blocks = new List<BasicBlock>();
@@ -209,12 +264,12 @@ namespace Natsu.Compiler
             }
         }
 
-        private void VisitBlock(int ident, BasicBlock block, HashSet<BasicBlock> visited, List<SpillSlot> spills, StringWriter writer = null, EvaluationStack stack = null)
+        private void VisitBlock(int ident, BasicBlock block, HashSet<BasicBlock> visited, List<SpillSlot> spills, RootPool roots, StringWriter writer = null, EvaluationStack stack = null)
         {
             visited.Add(block);
 
             writer = writer ?? new StringWriter();
-            stack = stack ?? new EvaluationStack(writer, ident, _paramIndex);
+            stack = stack ?? new EvaluationStack(writer, ident, _paramIndex, roots);
             writer.WriteLine(ILUtils.GetLabel(_method, block.Id) + ":");
 
             // import spills
@@ -255,8 +310,11 @@ namespace Natsu.Compiler
 
                         instW.Ident(ident).WriteLine($"auto _scope_finally = natsu::make_finally([{string.Join(", ", captures)}]{{");
                         var finallySpills = new List<SpillSlot>();
-                        VisitBlock(ident + 1, tryEnter.Value.HeadBlock, new HashSet<BasicBlock>(), finallySpills, stack: tryEnterStack);
+                        var finallyRoots = new RootPool();
+                        VisitBlock(ident + 1, tryEnter.Value.HeadBlock, new HashSet<BasicBlock>(), finallySpills, finallyRoots, stack: tryEnterStack);
                         WriteSpills(finallySpills, instW, ident + 1);
+                        WriteRoots(finallyRoots.Roots, instW, ident + 1);
+                        WriteGCFrame(finallySpills, finallyRoots.Roots, instW, ident + 1, false);
                         VisitBlockText(tryEnter.Value.HeadBlock, instW, visited);
                         instW.Ident(ident).WriteLine("});");
                         tryEnter.Value.EnterProcessed = true;
@@ -310,7 +368,7 @@ namespace Natsu.Compiler
             foreach (var next in block.Next)
             {
                 if (!visited.Contains(next))
-                    VisitBlock(ident, next, visited, spills);
+                    VisitBlock(ident, next, visited, spills, roots);
             }
         }
 
@@ -344,7 +402,7 @@ namespace Natsu.Compiler
 
         private void WriteInstruction(TextWriter writer, Instruction op, EvaluationStack stack, int ident, BasicBlock block)
         {
-            var emitter = new OpEmitter { CorLibTypes = _corLibTypes, ModuleName = ModuleName, UserStrings = UserStrings, Method = _method, Op = op, Stack = stack, Ident = ident, Block = block, Writer = writer };
+            var emitter = new OpEmitter { CorLibTypes = _corLibTypes, ModuleName = ModuleName, UserStrings = UserStrings, UserStringPrefix = UserStringPrefix, Method = _method, Op = op, Stack = stack, Ident = ident, Block = block, Writer = writer, StackAllocations = _stackAllocations, UncheckedAccesses = _uncheckedAccesses, RedundantNullChecks = _redundantNullChecks, StackObjects = _stackObjects };
             bool isSpecial = true;
 
             if (op.IsLdarg())
@@ -849,7 +907,12 @@ namespace Natsu.Compiler
         public TextWriter Writer { get; set; }
         public string ModuleName { get; set; }
         public List<string> UserStrings { get; set; }
+        public string UserStringPrefix { get; set; }
         public CorLibTypes CorLibTypes { get; set; }
+        public HashSet<Instruction> StackAllocations { get; set; }
+        public HashSet<Instruction> UncheckedAccesses { get; set; }
+        public HashSet<Instruction> RedundantNullChecks { get; set; }
+        public List<(string type, string name)> StackObjects { get; set; }
 
         // Unary
 
@@ -962,7 +1025,7 @@ namespace Natsu.Compiler
         {
             var value = Stack.Pop();
             var addr = Stack.Pop();
-            Writer.Ident(Ident).WriteLine($"*{addr.Expression} = {value.Expression};");
+            Writer.Ident(Ident).WriteLine($"{WriteBarrier($"*{addr.Expression}")} = {value.Expression};");
         }
 
         // Ldelem
@@ -978,7 +1041,7 @@ namespace Natsu.Compiler
             var index = Stack.Pop();
             var array = Stack.Pop();
             var elemType = array.Type.TypeSig.Next;
-            Stack.Push(elemType.ToTypeDefOrRef(), $"{array.Expression}->at({index.Expression})");
+            Stack.Push(elemType.ToTypeDefOrRef(), ElementAccess(array, index));
         }
         public void Ldelem_U1() => Ldelem(CorLibTypes.Byte, "u1");
         public void Ldelem_U2() => Ldelem(CorLibTypes.UInt16, "u2");
@@ -992,7 +1055,13 @@ namespace Natsu.Compiler
         public void Stelem_R4() => Stelem("r4");
         public void Stelem_R8() => Stelem("r8");
         public void Stelem_I() => Stelem("i");
-        public void Stelem_Ref() => Stelem("ref");
+        public void Stelem_Ref()
+        {
+            var value = Stack.Pop();
+            var index = Stack.Pop();
+            var array = Stack.Pop();
+            Writer.Ident(Ident).WriteLine($"{WriteBarrier(ElementAccess(array, index))} = {value.Expression};");
+        }
 
         public void Ldarg()
         {
@@ -1057,7 +1126,12 @@ namespace Natsu.Compiler
             var gen = (member as MethodSpec)?.GenericInstMethodSig;
             para.Reverse();
             string expr;
-            if (gen != null)
+            if (TryLowerIntrinsic(member, para, tGen, gen?.GenericArguments, out expr))
+            {
+                if (gen != null)
+                    tGen.AddRange(gen.GenericArguments);
+            }
+            else if (gen != null)
             {
                 var genArgs = gen.GenericArguments;
                 tGen.AddRange(genArgs);
@@ -1070,9 +1144,20 @@ namespace Natsu.Compiler
 
             var stackType = TypeUtils.GetStackType(method.RetType, tGen);
             if (stackType.Code == StackTypeCode.Void)
+            {
                 Stack.Push(stackType, expr);
+            }
             else
+            {
                 Stack.Push(stackType, $"{expr}");
+                Stack.Root();
+            }
+        }
+
+        // Interface calls look the interface vtable up in the interface map, starting at the constant home slot of the interface
+        private static string VTableAccessor(IMethod method)
+        {
+            return method.DeclaringType.ResolveTypeDef()?.IsInterface == true ? "interface_vtable" : "vtable_as";
         }
 
         public void Callvirt()
@@ -1108,16 +1193,229 @@ namespace Natsu.Compiler
 
                 Stack.Constrained = null;
             }
+            else if (TryGetSingleTarget(member, out var targetType, out var target))
+            {
+                // The call can only reach one method, bind it statically but keep the null check of callvirt
+                // unless the receiver is known to be non-null
+                para[0] = (TypeUtils.ThisType(targetType), para[0].src);
+                var args = para.Select(x => CastExpression(x.destType, x.src, tGen)).ToList();
+                if (!RedundantNullChecks.Contains(Op))
+                    args[0] = $"::natsu::ops::check_this({args[0]})";
+                expr = $"{TypeUtils.EscapeTypeName(targetType)}::{TypeUtils.EscapeMethodName(target, hasParamType: false)}({string.Join(", ", args)})";
+            }
             else
             {
-                expr = $"{para[0].src.Expression}.header().template vtable_as<typename {TypeUtils.EscapeTypeName(member.DeclaringType)}::VTable>()->{TypeUtils.EscapeMethodName(member)}({string.Join(", ", para.Select(x => CastExpression(x.destType, x.src, tGen)))})";
+                expr = $"{para[0].src.Expression}.header().template {VTableAccessor(member)}<typename {TypeUtils.EscapeTypeName(member.DeclaringType)}::VTable>()->{TypeUtils.EscapeMethodName(member)}({string.Join(", ", para.Select(x => CastExpression(x.destType, x.src, tGen)))})";
             }
 
             var stackType = TypeUtils.GetStackType(method.RetType, tGen);
             if (stackType.Code == StackTypeCode.Void)
+            {
                 Stack.Push(stackType, expr);
+            }
             else
+            {
                 Stack.Push(stackType, $"{expr}");
+                Stack.Root();
+            }
+        }
+
+        // BitOperations and Unsafe helpers lower to builtins and pointer arithmetic instead of calls to their managed bodies,
+        // Vector128 operations lower to natsu::simd
+        private static bool TryLowerIntrinsic(IMethod member, List<(TypeSig destType, StackEntry src)> para, IList<TypeSig> typeGenArgs, IList<TypeSig> genArgs, out string expr)
+        {
+            expr = null;
+            var args = para.Select(x => CastExpression(x.destType, x.src, genArgs)).ToList();
+            var method = member.MethodSig;
+            var firstParam = method.Params.Count != 0 ? method.Params[0].ElementType : ElementType.End;
+
+            switch (member.DeclaringType.ScopeType?.FullName)
+            {
+                case "System.Numerics.BitOperations":
+                    {
+                        var is64 = firstParam == ElementType.U8 || firstParam == ElementType.I8;
+                        var value = method.Params.Count != 0 ? $"static_cast<{(is64 ? "uint64_t" : "uint32_t")}>({args[0]})" : null;
+                        switch (member.Name)
+                        {
+                            case "PopCount":
+                                expr = $"::natsu::ops::popcount({value})";
+                                break;
+                            case "LeadingZeroCount":
+                                expr = $"::natsu::ops::lzcnt({value})";
+                                break;
+                            case "TrailingZeroCount":
+                                expr = $"::natsu::ops::tzcnt({value})";
+                                break;
+                            case "Log2":
+                                expr = $"::natsu::ops::log2({value})";
+                                break;
+                            case "RotateLeft":
+                                expr = $"::natsu::ops::rotl({value}, {args[1]})";
+                                break;
+                            case "RotateRight":
+                                expr = $"::natsu::ops::rotr({value}, {args[1]})";
+                                break;
+                        }
+
+                        break;
+                    }
+                case "Internal.Runtime.CompilerServices.Unsafe":
+                    {
+                        if (genArgs == null)
+                            break;
+
+                        // Sizes and offsets are of the variable type, references for reference types
+                        var elementType = TypeUtils.EscapeVariableTypeName(genArgs[genArgs.Count - 1]);
+                        switch (member.Name)
+                        {
+                            case "SizeOf":
+                                expr = $"int32_t(sizeof({elementType}))";
+                                break;
+                            case "As" when genArgs.Count == 2:
+                                expr = $"::natsu::ops::ref_as<{elementType}>({args[0]})";
+                                break;
+                            case "Add" when TypeUtils.IsByRef(method.Params[0]):
+                                expr = $"::natsu::ops::ref_add<{elementType}>({args[0]}, {args[1]})";
+                                break;
+                            case "AddByteOffset":
+                                expr = $"::natsu::ops::ref_add_byte_offset<{elementType}>({args[0]}, {args[1]})";
+                                break;
+                            case "ReadUnaligned" when genArgs[0].IsValueType:
+                                expr = $"::natsu::ops::read_unaligned<{elementType}>({args[0]})";
+                                break;
+                        }
+
+                        break;
+                    }
+                case "System.Runtime.Intrinsics.Vector128`1":
+                    {
+                        if (typeGenArgs.Count != 1)
+                            break;
+
+                        var op = member.Name.StartsWith("op_") ? VectorHelper(member.Name) : null;
+                        var elementType = TypeUtils.EscapeVariableTypeName(typeGenArgs[0]);
+                        if (member.Name == "get_AllBitsSet")
+                            expr = $"::natsu::simd::all_bits_set<{TypeUtils.EscapeVariableTypeName(method.RetType, genArgs: typeGenArgs)}>()";
+                        else if (member.Name == "op_Inequality")
+                            expr = $"!::natsu::simd::equals_all<{elementType}>({string.Join(", ", args)})";
+                        else if (op != null)
+                            expr = $"::natsu::simd::{op}<{elementType}>({string.Join(", ", args)})";
+                        break;
+                    }
+                case "System.Runtime.Intrinsics.Vector128":
+                    {
+                        if (member.Name == "get_IsHardwareAccelerated")
+                        {
+                            expr = "::natsu::simd::is_hardware_accelerated";
+                            break;
+                        }
+                        else if (member.Name == "Shuffle")
+                        {
+                            var elementType = ((GenericInstSig)method.Params[0]).GenericArguments[0];
+                            var indexType = ((GenericInstSig)method.Params[1]).GenericArguments[0];
+                            expr = $"::natsu::simd::shuffle<{TypeUtils.EscapeVariableTypeName(elementType)}, {TypeUtils.EscapeVariableTypeName(indexType)}>({string.Join(", ", args)})";
+                            break;
+                        }
+                        else if (genArgs?.Count != 1)
+                        {
+                            break;
+                        }
+
+                        var element = TypeUtils.EscapeVariableTypeName(genArgs[0]);
+                        switch (member.Name)
+                        {
+                            case "Create" when method.Params[0].ElementType == ElementType.MVar:
+                                expr = $"::natsu::simd::create<{element}, {TypeUtils.EscapeVariableTypeName(method.RetType, genArgs: genArgs)}>({args[0]})";
+                                break;
+                            case "LoadUnsafe":
+                                expr = $"::natsu::simd::load<{TypeUtils.EscapeVariableTypeName(method.RetType, genArgs: genArgs)}>({args[0]})";
+                                break;
+                            case "StoreUnsafe":
+                                expr = $"::natsu::simd::store({args[0]}, {args[1]})";
+                                break;
+                            default:
+                                var helper = VectorHelper(member.Name);
+                                if (helper != null)
+                                    expr = $"::natsu::simd::{helper}<{element}>({string.Join(", ", args)})";
+                                break;
+                        }
+
+                        break;
+                    }
+            }
+
+            return expr != null;
+        }
+
+        // The natsu::simd helper implementing a Vector128<T> operator or Vector128 method
+        private static string VectorHelper(string name)
+        {
+            switch (name)
+            {
+                case "op_Addition":
+                    return "add";
+                case "op_Subtraction":
+                    return "subtract";
+                case "op_Multiply":
+                    return "multiply";
+                case "op_Division":
+                    return "divide";
+                case "op_UnaryNegation":
+                    return "negate";
+                case "op_BitwiseAnd":
+                    return "bitwise_and";
+                case "op_BitwiseOr":
+                    return "bitwise_or";
+                case "op_ExclusiveOr":
+                    return "exclusive_or";
+                case "op_OnesComplement":
+                    return "ones_complement";
+                case "op_Equality":
+                    return "equals_all";
+                case "Equals":
+                    return "equals";
+                case "LessThan":
+                    return "less_than";
+                case "LessThanOrEqual":
+                    return "less_than_or_equal";
+                case "GreaterThan":
+                    return "greater_than";
+                case "GreaterThanOrEqual":
+                    return "greater_than_or_equal";
+                case "Min":
+                    return "min";
+                case "Max":
+                    return "max";
+                case "Abs":
+                    return "abs";
+                case "Sqrt":
+                    return "sqrt";
+                case "ConditionalSelect":
+                    return "conditional_select";
+                case "Sum":
+                    return "sum";
+                case "Dot":
+                    return "dot";
+                default:
+                    return null;
+            }
+        }
+
+        internal static bool TryGetSingleTarget(IMethod member, out ITypeDefOrRef targetType, out MethodDef target)
+        {
+            targetType = null;
+            target = member is MethodSpec ? null : member.ResolveMethodDef();
+            if (target != null)
+                target = ClassHierarchy.FindSingleTarget(target);
+            if (target == null || target.DeclaringType.IsValueType || target.Name.Contains("."))
+                return false;
+
+            // Generic arguments are only known for the type the call site names
+            if (target.DeclaringType == member.DeclaringType.ResolveTypeDef())
+                targetType = member.DeclaringType;
+            else if (!target.DeclaringType.HasGenericParameters)
+                targetType = target.DeclaringType;
+            return targetType != null;
         }
 
         private static string CastExpression(TypeSig destType, StackEntry src, IList<TypeSig> genArgs = null)
@@ -1304,10 +1602,11 @@ namespace Natsu.Compiler
             var type = TypeUtils.IsRefOrPtr(v1.Type) && TypeUtils.IsRefOrPtr(v2.Type)
                 ? TypeUtils.GetStackType(CorLibTypes.IntPtr)
                 : v1.Type;
+            type = PromoteFloat(type, v2.Type);
 
             if (op == "%" && v1.Type.Code == StackTypeCode.F)
             {
-                if (v1.Type.TypeSig.ElementType == ElementType.R4)
+                if (IsSingle(type))
                     Stack.Push(type, $"fmodf({v1.Expression}, {v2.Expression})");
                 else
                     Stack.Push(type, $"fmod({v1.Expression}, {v2.Expression})");
@@ -1328,10 +1627,11 @@ namespace Natsu.Compiler
             var type = TypeUtils.IsRefOrPtr(v1.Type) && TypeUtils.IsRefOrPtr(v2.Type)
                 ? TypeUtils.GetStackType(CorLibTypes.IntPtr)
                 : v1.Type;
+            type = PromoteFloat(type, v2.Type);
 
             if (op == "%" && v1.Type.Code == StackTypeCode.F)
             {
-                if (v1.Type.TypeSig.ElementType == ElementType.R4)
+                if (IsSingle(type))
                     Stack.Push(type, $"fmodf({v1.Expression}, {v2.Expression})");
                 else
                     Stack.Push(type, $"fmod({v1.Expression}, {v2.Expression})");
@@ -1352,10 +1652,11 @@ namespace Natsu.Compiler
             var type = TypeUtils.IsRefOrPtr(v1.Type) && TypeUtils.IsRefOrPtr(v2.Type)
                 ? TypeUtils.GetStackType(CorLibTypes.IntPtr)
                 : v1.Type;
+            type = PromoteFloat(type, v2.Type);
 
             if (op == "%" && v1.Type.Code == StackTypeCode.F)
             {
-                if (v1.Type.TypeSig.ElementType == ElementType.R4)
+                if (IsSingle(type))
                     Stack.Push(type, $"fmodf({v1.Expression}, {v2.Expression})");
                 else
                     Stack.Push(type, $"fmod({v1.Expression}, {v2.Expression})");
@@ -1376,9 +1677,10 @@ namespace Natsu.Compiler
             var type = TypeUtils.IsRefOrPtr(v1.Type) && TypeUtils.IsRefOrPtr(v2.Type)
                 ? TypeUtils.GetStackType(CorLibTypes.UIntPtr)
                 : v1.Type;
+            type = PromoteFloat(type, v2.Type);
             if (op == "%" && v1.Type.Code == StackTypeCode.F)
             {
-                if (v1.Type.TypeSig.ElementType == ElementType.R4)
+                if (IsSingle(type))
                     Stack.Push(type, $"fmodf({v1.Expression}, {v2.Expression})");
                 else
                     Stack.Push(type, $"fmod({v1.Expression}, {v2.Expression})");
@@ -1389,6 +1691,19 @@ namespace Natsu.Compiler
             }
         }
 
+        // float32 arithmetic stays in single precision, mixing in a float64 operand widens the result
+        private StackType PromoteFloat(StackType type, StackType other)
+        {
+            if (type.Code == StackTypeCode.F && other.Code == StackTypeCode.F && IsSingle(type) && !IsSingle(other))
+                return other;
+            return type;
+        }
+
+        private static bool IsSingle(StackType type)
+        {
+            return type.Code == StackTypeCode.F && type.TypeSig.RemovePinnedAndModifiers().ElementType == ElementType.R4;
+        }
+
         public void Compare(string op)
         {
             var v2 = Stack.Pop();
@@ -1449,7 +1764,7 @@ namespace Natsu.Compiler
         public void Ldstr()
         {
             var value = (string)Op.Operand;
-            Stack.Push(CorLibTypes.String, $"::{ ModuleName}::user_string_{UserStrings.Count}.get()");
+            Stack.Push(CorLibTypes.String, $"::{ ModuleName}::{UserStringPrefix}{UserStrings.Count}.get()");
             UserStrings.Add(value);
         }
 
@@ -1458,7 +1773,7 @@ namespace Natsu.Compiler
             var field = (IField)Op.Operand;
             string expr = Method.IsStaticConstructor && TypeUtils.IsSameType(Method.DeclaringType, field.DeclaringType)
                 ? TypeUtils.EscapeIdentifier(field.Name)
-                : "::natsu::static_holder<typename" + TypeUtils.EscapeTypeName(field.DeclaringType) + "::Static>::get()." + TypeUtils.EscapeIdentifier(field.Name);
+                : TypeUtils.EscapeStaticFieldName(field);
             var fieldType = field.FieldSig.Type;
             if (Stack.PopVolatile())
                 expr += ".load()";
@@ -1505,7 +1820,7 @@ namespace Natsu.Compiler
             var fieldType = field.FieldSig.Type;
             string expr = Method.IsStaticConstructor && TypeUtils.IsSameType(Method.DeclaringType, field.DeclaringType)
                 ? TypeUtils.EscapeIdentifier(field.Name)
-                : "::natsu::static_holder<typename" + TypeUtils.EscapeTypeName(field.DeclaringType) + "::Static>::get()." + TypeUtils.EscapeIdentifier(field.Name);
+                : TypeUtils.EscapeStaticFieldName(field);
             Stack.Push(TypeUtils.GetStackType(new ByRefSig(fieldType)), $"::natsu::ops::ref({expr})", computed: true);
         }
 
@@ -1519,7 +1834,7 @@ namespace Natsu.Compiler
                 ;
             string expr = Method.IsStaticConstructor && TypeUtils.IsSameType(Method.DeclaringType, field.DeclaringType)
                 ? TypeUtils.EscapeIdentifier(field.Name)
-                : "::natsu::static_holder<typename" + TypeUtils.EscapeTypeName(field.DeclaringType) + "::Static>::get()." + TypeUtils.EscapeIdentifier(field.Name);
+                : TypeUtils.EscapeStaticFieldName(field);
             var fieldType = field.FieldSig.Type;
 
             if (Stack.PopVolatile())
@@ -1536,6 +1851,8 @@ namespace Natsu.Compiler
             var thisType = TypeUtils.ThisType(field.DeclaringType);
             string expr = MakeAccessExpression(target) + TypeUtils.EscapeIdentifier(field.Name);
             var fieldType = field.FieldSig.Type;
+            if (TypeUtils.MayContainGCRefs(fieldType))
+                expr = WriteBarrier(expr);
 
             if (Stack.PopVolatile())
                 Writer.Ident(Ident).WriteLine($"{expr}.store({CastExpression(fieldType, value)});");
@@ -1548,6 +1865,7 @@ namespace Natsu.Compiler
             var type = (ITypeDefOrRef)Op.Operand;
             var len = Stack.Pop();
             Stack.Push(new SZArraySig(type.ToTypeSig()).ToTypeDefOrRef(), $"::natsu::gc_new_array<{TypeUtils.EscapeTypeName(type, cppBasicType: true)}>({len.Expression})");
+            Stack.Root();
         }
 
         public void Initobj()
@@ -1568,8 +1886,25 @@ namespace Natsu.Compiler
 
             para.Reverse();
             var genSig = member.DeclaringType.TryGetGenericInstSig();
-            var expr = $"::natsu::ops::newobj<{TypeUtils.EscapeTypeName(member.DeclaringType, cppBasicType: true)}>({string.Join(", ", para.Select(x => CastExpression(x.destType, x.src, genSig?.GenericArguments)))})";
+            var typeName = TypeUtils.EscapeTypeName(member.DeclaringType, cppBasicType: true);
+            var args = para.Select(x => CastExpression(x.destType, x.src, genSig?.GenericArguments)).ToList();
+            string expr;
+
+            // The object never escapes this method, keep it in the frame
+            if (StackAllocations.Contains(Op))
+            {
+                var name = $"_o{StackObjects.Count}";
+                StackObjects.Add((typeName, name));
+                args.Insert(0, name);
+                expr = $"::natsu::ops::newobj_stack<{typeName}>({string.Join(", ", args)})";
+            }
+            else
+            {
+                expr = $"::natsu::ops::newobj<{typeName}>({string.Join(", ", args)})";
+            }
+
             Stack.Push(TypeUtils.GetStackType(member.DeclaringType.ToTypeSig()), expr);
+            Stack.Root();
         }
 
         public void Ldobj()
@@ -1584,7 +1919,16 @@ namespace Natsu.Compiler
             var type = (ITypeDefOrRef)Op.Operand;
             var src = Stack.Pop();
             var dest = Stack.Pop();
-            Writer.Ident(Ident).WriteLine($"*{dest.Expression} = {src.Expression};");
+            var expr = $"*{dest.Expression}";
+            if (TypeUtils.MayContainGCRefs(type.ToTypeSig()))
+                expr = WriteBarrier(expr);
+            Writer.Ident(Ident).WriteLine($"{expr} = {src.Expression};");
+        }
+
+        // Dirties the card of a slot a reference is stored to, static storage is always a root so it needs none
+        private static string WriteBarrier(string slot)
+        {
+            return $"::natsu::gc_barrier({slot})";
         }
 
         public void Ldtoken()
@@ -1697,7 +2041,7 @@ namespace Natsu.Compiler
                 }
             }
 
-            Stack.Push(stackType, $"::natsu::ops::ldind<{TypeUtils.EscapeVariableTypeName(stackType)}>({addr.Expression})");
+            Stack.Push(stackType, $"::natsu::ops::{IndirectAccessor("ldind")}<{TypeUtils.EscapeVariableTypeName(stackType)}>({addr.Expression})");
         }
 
         private void Stind(TypeSig stackType)
@@ -1720,14 +2064,22 @@ namespace Natsu.Compiler
                 }
             }
 
-            Writer.Ident(Ident).WriteLine($"::natsu::ops::stind<{TypeUtils.EscapeVariableTypeName(stackType)}>({addr.Expression}, {value.Expression});");
+            Writer.Ident(Ident).WriteLine($"::natsu::ops::{IndirectAccessor("stind")}<{TypeUtils.EscapeVariableTypeName(stackType)}>({addr.Expression}, {value.Expression});");
+        }
+
+        // Addresses the null check analysis proved non-null skip the check
+        private string IndirectAccessor(string accessor)
+        {
+            if (RedundantNullChecks.Contains(Op))
+                accessor += "_unchecked";
+            return accessor;
         }
 
         private void Ldelem(TypeSig stackType, string type)
         {
             var index = Stack.Pop();
             var array = Stack.Pop();
-            Stack.Push(stackType, $"{array.Expression}->at({index.Expression})");
+            Stack.Push(stackType, ElementAccess(array, index));
         }
 
         private void Stelem(string type)
@@ -1736,7 +2088,7 @@ namespace Natsu.Compiler
             var index = Stack.Pop();
             var array = Stack.Pop();
             //Writer.Ident(Ident).WriteLine($"::natsu::ops::stelem_{type}({array.Expression}, {index.Expression}, {value.Expression});");
-            Writer.Ident(Ident).WriteLine($"{array.Expression}->at({index.Expression}) = {value.Expression};");
+            Writer.Ident(Ident).WriteLine($"{ElementAccess(array, index)} = {value.Expression};");
         }
 
         public void Ldelem()
@@ -1744,7 +2096,7 @@ namespace Natsu.Compiler
             var type = (ITypeDefOrRef)Op.Operand;
             var index = Stack.Pop();
             var array = Stack.Pop();
-            Stack.Push(TypeUtils.GetStackType(type.ToTypeSig()), $"{array.Expression}->at({index.Expression})");
+            Stack.Push(TypeUtils.GetStackType(type.ToTypeSig()), ElementAccess(array, index));
         }
 
         public void Stelem()
@@ -1753,7 +2105,10 @@ namespace Natsu.Compiler
             var value = Stack.Pop();
             var index = Stack.Pop();
             var array = Stack.Pop();
-            Writer.Ident(Ident).WriteLine($"{array.Expression}->at({index.Expression}) = {value.Expression};");
+            var expr = ElementAccess(array, index);
+            if (TypeUtils.MayContainGCRefs(type.ToTypeSig()))
+                expr = WriteBarrier(expr);
+            Writer.Ident(Ident).WriteLine($"{expr} = {value.Expression};");
         }
 
         public void Ldelema()
@@ -1761,7 +2116,16 @@ namespace Natsu.Compiler
             var type = (ITypeDefOrRef)Op.Operand;
             var index = Stack.Pop();
             var array = Stack.Pop();
-            Stack.Push(TypeUtils.GetStackType(new ByRefSig(type.ToTypeSig())), $"{array.Expression}->ref_at({index.Expression})");
+            Stack.Push(TypeUtils.GetStackType(new ByRefSig(type.ToTypeSig())), ElementAccess(array, index, true));
+        }
+
+        // Accesses the range analysis proved in bounds skip the index check
+        private string ElementAccess(StackEntry array, StackEntry index, bool byRef = false)
+        {
+            var accessor = byRef ? "ref_at" : "at";
+            if (UncheckedAccesses.Contains(Op))
+                accessor += "_unchecked";
+            return $"{array.Expression}->{accessor}({index.Expression})";
         }
 
         public void Box()
@@ -1769,6 +2133,7 @@ namespace Natsu.Compiler
             var type = (ITypeDefOrRef)Op.Operand;
             var value = Stack.Pop();
             Stack.Push(CorLibTypes.Object, $"::natsu::ops::box({CastExpression(type.ToTypeSig(), value)})");
+            Stack.Root();
         }
 
         public void Ldnull()
@@ -1820,7 +2185,7 @@ namespace Natsu.Compiler
             else
             {
                 var obj = Stack.Pop();
-                expr = $"{obj.Expression}.header().template vtable_as<typename {TypeUtils.EscapeTypeName(member.DeclaringType)}::VTable>()->{TypeUtils.EscapeMethodName(member)}";
+                expr = $"{obj.Expression}.header().template {VTableAccessor(member)}<typename {TypeUtils.EscapeTypeName(member.DeclaringType)}::VTable>()->{TypeUtils.EscapeMethodName(member)}";
             }
 
             Stack.Push(CorLibTypes.IntPtr, $"::natsu::ops::ldftn({expr})");
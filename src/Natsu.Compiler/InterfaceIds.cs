@@ -0,0 +1,35 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using dnlib.DotNet;
+
+namespace Natsu.Compiler
+{
+    // Numbers the interfaces of all compiled modules, an interface cast hashes the id into the interface map of the vtable.
+    // Ids come from the interface name so adding an interface does not renumber the others
+    static class InterfaceIds
+    {
+        private static readonly Dictionary<TypeDef, uint> _ids = new Dictionary<TypeDef, uint>();
+
+        public static void Assign(IEnumerable<ModuleDef> modules)
+        {
+            var used = new HashSet<uint>();
+            var interfaces = modules.SelectMany(x => x.GetTypes())
+                .Where(x => x.IsInterface)
+                .OrderBy(x => x.FullName, StringComparer.Ordinal);
+            foreach (var type in interfaces)
+            {
+                // Rehash the rare collision so distinct interfaces never share a home slot by id
+                var id = TypeUtils.StableHash(type.FullName);
+                while (!used.Add(id))
+                    id = id * 16777619u + 1;
+                _ids.Add(type, id);
+            }
+        }
+
+        public static uint GetId(TypeDef type)
+        {
+            return _ids.TryGetValue(type, out var id) ? id : TypeUtils.StableHash(type.FullName);
+        }
+    }
+}
@@ -0,0 +1,376 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace Natsu.Compiler
+{
+    // Forward dataflow over locals and arguments known to be non-null, finds callvirt and ldind/stind sites that need no null check.
+    // A plain dereference doesn't fault on a null address without an MMU, so facts only come from explicit checks,
+    // allocations and this
+    static class NullCheckAnalysis
+    {
+        private const string NonNull = "nn";
+        private const string NullConstant = "null";
+
+        private class State
+        {
+            // Variables holding a non-null reference, l<index> for locals and a<index> for arguments
+            public HashSet<string> Facts { get; }
+
+            // What each stack slot holds, a variable, nn, null or unknown
+            public List<string> Stack { get; }
+
+            public State(HashSet<string> facts, List<string> stack)
+            {
+                Facts = facts;
+                Stack = stack;
+            }
+        }
+
+        public static HashSet<Instruction> FindRedundantNullChecks(MethodDef method)
+        {
+            var result = new HashSet<Instruction>();
+            if (!method.HasBody || !method.Body.Instructions.Any(x => x.OpCode.Code == Code.Callvirt || IsIndirect(x.OpCode.Code)))
+                return result;
+
+            var states = Analyze(method);
+            if (states == null)
+                return result;
+
+            foreach (var inst in method.Body.Instructions)
+            {
+                if (!states.TryGetValue(inst, out var state))
+                    continue;
+
+                var stack = state.Stack;
+                var code = inst.OpCode.Code;
+                string target = null;
+                if (code == Code.Callvirt)
+                    target = stack[stack.Count - 1 - ((IMethod)inst.Operand).MethodSig.Params.Count];
+                else if (IsLoadIndirect(code))
+                    target = stack[stack.Count - 1];
+                else if (IsStoreIndirect(code))
+                    target = stack[stack.Count - 2];
+
+                if (target != null && IsNonNull(state.Facts, target))
+                    result.Add(inst);
+            }
+
+            return result;
+        }
+
+        // Ldind.ref and stind.ref dereference in place and have no check to drop
+        private static bool IsLoadIndirect(Code code)
+        {
+            return code >= Code.Ldind_I1 && code <= Code.Ldind_R8;
+        }
+
+        private static bool IsStoreIndirect(Code code)
+        {
+            return (code >= Code.Stind_I1 && code <= Code.Stind_R8) || code == Code.Stind_I;
+        }
+
+        private static bool IsIndirect(Code code)
+        {
+            return IsLoadIndirect(code) || IsStoreIndirect(code);
+        }
+
+        // Callvirt only checks the receiver when it binds statically, the vtable load of a virtual dispatch doesn't
+        private static bool ChecksReceiver(Instruction inst, Instruction previous)
+        {
+            if (previous != null && previous.OpCode.Code == Code.Constrained)
+                return false;
+            return OpEmitter.TryGetSingleTarget((IMethod)inst.Operand, out _, out _);
+        }
+
+        // Ldind/stind check the address unless they are lowered to a plain dereference of a matching pointer,
+        // byrefs are never checked
+        private static bool ChecksAddress(Instruction inst, TypeSig addressType, ICorLibTypes corLibTypes)
+        {
+            addressType = addressType.RemovePinnedAndModifiers();
+            if (addressType.ElementType == ElementType.ByRef)
+                return false;
+            if (addressType.ElementType != ElementType.Ptr)
+                return true;
+            if (!IsLoadIndirect(inst.OpCode.Code))
+                return false;
+            return !TypeUtils.IsSameType(addressType.Next.ToTypeDefOrRef(), LoadedType(inst.OpCode.Code, corLibTypes).ToTypeDefOrRef());
+        }
+
+        private static TypeSig LoadedType(Code code, ICorLibTypes corLibTypes)
+        {
+            switch (code)
+            {
+                case Code.Ldind_I1:
+                    return corLibTypes.SByte;
+                case Code.Ldind_I2:
+                    return corLibTypes.Int16;
+                case Code.Ldind_I4:
+                    return corLibTypes.Int32;
+                case Code.Ldind_I8:
+                    return corLibTypes.Int64;
+                case Code.Ldind_R4:
+                    return corLibTypes.Single;
+                case Code.Ldind_R8:
+                    return corLibTypes.Double;
+                case Code.Ldind_I:
+                    return corLibTypes.IntPtr;
+                case Code.Ldind_U1:
+                    return corLibTypes.Byte;
+                case Code.Ldind_U2:
+                    return corLibTypes.UInt16;
+                case Code.Ldind_U4:
+                    return corLibTypes.UInt32;
+                default:
+                    throw new ArgumentOutOfRangeException(nameof(code));
+            }
+        }
+
+        private static bool IsNonNull(HashSet<string> facts, string value)
+        {
+            return value == NonNull || (value != null && facts.Contains(value));
+        }
+
+        private static bool IsVariable(string value)
+        {
+            return value != null && value != NonNull && value != NullConstant;
+        }
+
+        private static Dictionary<Instruction, State> Analyze(MethodDef method)
+        {
+            var body = method.Body;
+            var instructions = body.Instructions;
+            var hasReturnValue = method.ReturnType.ElementType != ElementType.Void;
+            var addressTaken = new HashSet<string>();
+            foreach (var inst in instructions)
+            {
+                if (inst.OpCode.Code == Code.Ldloca || inst.OpCode.Code == Code.Ldloca_S)
+                    addressTaken.Add("l" + inst.GetLocal(body.Variables).Index);
+                else if (inst.OpCode.Code == Code.Ldarga || inst.OpCode.Code == Code.Ldarga_S)
+                    addressTaken.Add("a" + inst.GetParameterIndex());
+            }
+
+            var states = new Dictionary<Instruction, State>();
+            var pending = new Stack<Instruction>();
+            bool consistent = true;
+
+            void Flow(Instruction target, HashSet<string> facts, List<string> stack)
+            {
+                if (!states.TryGetValue(target, out var state))
+                {
+                    states.Add(target, new State(new HashSet<string>(facts), new List<string>(stack)));
+                    pending.Push(target);
+                }
+                else if (state.Stack.Count != stack.Count)
+                {
+                    consistent = false;
+                }
+                else
+                {
+                    var count = state.Facts.Count;
+                    state.Facts.IntersectWith(facts);
+                    bool changed = state.Facts.Count != count;
+                    for (int i = 0; i < stack.Count; i++)
+                    {
+                        if (state.Stack[i] != null && state.Stack[i] != stack[i])
+                        {
+                            state.Stack[i] = null;
+                            changed = true;
+                        }
+                    }
+
+                    if (changed)
+                        pending.Push(target);
+                }
+            }
+
+            // This of a reference type method can't be null, callvirt checked it
+            var entryFacts = new HashSet<string>();
+            if (method.HasThis && !method.DeclaringType.IsValueType && !addressTaken.Contains("a0"))
+                entryFacts.Add("a0");
+
+            if (instructions.Count != 0)
+                Flow(instructions[0], entryFacts, new List<string>());
+            foreach (var handler in body.ExceptionHandlers)
+            {
+                var entry = new List<string>();
+                if (handler.HandlerType == ExceptionHandlerType.Catch || handler.HandlerType == ExceptionHandlerType.Filter)
+                    entry.Add(NonNull);
+                Flow(handler.HandlerStart, new HashSet<string>(), entry);
+                if (handler.FilterStart != null)
+                    Flow(handler.FilterStart, new HashSet<string>(), entry);
+            }
+
+            while (pending.Count != 0 && consistent)
+            {
+                var inst = pending.Pop();
+                var state = states[inst];
+                var facts = new HashSet<string>(state.Facts);
+                var stack = new List<string>(state.Stack);
+                string taken = null, fallthrough = null;
+
+                string Pop()
+                {
+                    var value = stack[stack.Count - 1];
+                    stack.RemoveAt(stack.Count - 1);
+                    return value;
+                }
+
+                void Store(string variable, string value)
+                {
+                    var nonNull = IsNonNull(facts, value);
+                    facts.Remove(variable);
+                    for (int i = 0; i < stack.Count; i++)
+                    {
+                        if (stack[i] == variable)
+                            stack[i] = null;
+                    }
+
+                    if (nonNull)
+                        facts.Add(variable);
+                }
+
+                // A value that passed a null check is known to be non-null from then on
+                void Checked(string value)
+                {
+                    if (IsVariable(value))
+                        facts.Add(value);
+                }
+
+                TypeSig VariableType(string name)
+                {
+                    var index = int.Parse(name.Substring(1));
+                    return name[0] == 'l' ? body.Variables[index].Type : method.Parameters[index].Type;
+                }
+
+                string Variable(string name)
+                {
+                    return addressTaken.Contains(name) ? null : name;
+                }
+
+                inst.CalculateStackUsage(hasReturnValue, out var pushes, out var pops);
+                var code = inst.OpCode.Code;
+                if (inst.IsLdloc())
+                {
+                    stack.Add(Variable("l" + inst.GetLocal(body.Variables).Index));
+                }
+                else if (inst.IsLdarg())
+                {
+                    stack.Add(Variable("a" + inst.GetParameterIndex()));
+                }
+                else if (inst.IsStloc())
+                {
+                    var name = Variable("l" + inst.GetLocal(body.Variables).Index);
+                    var value = Pop();
+                    if (name != null)
+                        Store(name, value);
+                }
+                else if (inst.IsStarg())
+                {
+                    var name = Variable("a" + inst.GetParameterIndex());
+                    var value = Pop();
+                    if (name != null)
+                        Store(name, value);
+                }
+                else if (code == Code.Dup)
+                {
+                    stack.Add(stack[stack.Count - 1]);
+                }
+                else if (code == Code.Ldnull)
+                {
+                    stack.Add(NullConstant);
+                }
+                else if (code == Code.Newobj || code == Code.Newarr || code == Code.Ldstr)
+                {
+                    stack.RemoveRange(stack.Count - pops, pops);
+                    stack.Add(NonNull);
+                }
+                else if (code == Code.Callvirt)
+                {
+                    var args = stack.GetRange(stack.Count - pops, pops);
+                    stack.RemoveRange(stack.Count - pops, pops);
+                    var index = instructions.IndexOf(inst);
+                    if (ChecksReceiver(inst, index == 0 ? null : instructions[index - 1]))
+                        Checked(args[0]);
+                    for (int i = 0; i < pushes; i++)
+                        stack.Add(null);
+                }
+                else if (IsIndirect(code))
+                {
+                    var address = stack[stack.Count - pops];
+                    stack.RemoveRange(stack.Count - pops, pops);
+                    if (IsVariable(address) && ChecksAddress(inst, VariableType(address), method.Module.CorLibTypes))
+                        Checked(address);
+                    for (int i = 0; i < pushes; i++)
+                        stack.Add(null);
+                }
+                else if (code == Code.Brtrue || code == Code.Brtrue_S || code == Code.Brfalse || code == Code.Brfalse_S)
+                {
+                    var value = Pop();
+                    var fact = IsVariable(value) ? value : null;
+                    if (code == Code.Brtrue || code == Code.Brtrue_S)
+                        taken = fact;
+                    else
+                        fallthrough = fact;
+                }
+                else if (code == Code.Beq || code == Code.Beq_S || code == Code.Bne_Un || code == Code.Bne_Un_S)
+                {
+                    var y = Pop();
+                    var x = Pop();
+                    var fact = y == NullConstant && IsVariable(x) ? x : x == NullConstant && IsVariable(y) ? y : null;
+                    if (code == Code.Bne_Un || code == Code.Bne_Un_S)
+                        taken = fact;
+                    else
+                        fallthrough = fact;
+                }
+                else if (pops == -1)
+                {
+                    stack.Clear();
+                }
+                else
+                {
+                    stack.RemoveRange(stack.Count - pops, pops);
+                    for (int i = 0; i < pushes; i++)
+                        stack.Add(null);
+                }
+
+                HashSet<string> With(string fact)
+                {
+                    if (fact == null)
+                        return facts;
+                    return new HashSet<string>(facts) { fact };
+                }
+
+                switch (inst.OpCode.FlowControl)
+                {
+                    case FlowControl.Branch:
+                        Flow((Instruction)inst.Operand, facts, stack);
+                        continue;
+                    case FlowControl.Cond_Branch:
+                        if (inst.Operand is IList<Instruction> targets)
+                        {
+                            foreach (var target in targets)
+                                Flow(target, facts, stack);
+                        }
+                        else
+                        {
+                            Flow((Instruction)inst.Operand, With(taken), stack);
+                        }
+                        break;
+                    case FlowControl.Return:
+                    case FlowControl.Throw:
+                        continue;
+                }
+
+                var index = instructions.IndexOf(inst);
+                if (index < instructions.Count - 1)
+                    Flow(instructions[index + 1], With(fallthrough), stack);
+            }
+
+            return consistent ? states : null;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+
+namespace Natsu.Compiler
+{
+    // Method entry counts dumped by a NATSU_PROFILE build, hot methods get their own sections which the linker script
+    // places in profile order, methods the profile never entered are cold
+    static class ProfileGuidedLayout
+    {
+        private const string LinePrefix = "natsu-profile: ";
+
+        // Methods covering this share of all entries are hot, the rest of the executed ones is left to the C++ compiler
+        private const double HotCoverage = 0.99;
+
+        private static Dictionary<string, long> _counts;
+        private static readonly Dictionary<string, int> _hotRanks = new Dictionary<string, int>();
+
+        public static void Load(string path)
+        {
+            _counts = null;
+            _hotRanks.Clear();
+            if (!File.Exists(path))
+                return;
+
+            _counts = new Dictionary<string, long>();
+            foreach (var line in File.ReadLines(path))
+            {
+                var start = line.IndexOf(LinePrefix);
+                if (start == -1)
+                    continue;
+
+                var entry = line.Substring(start + LinePrefix.Length).TrimEnd();
+                var separator = entry.IndexOf(' ');
+                if (separator == -1 || !long.TryParse(entry.Substring(0, separator), out var count))
+                    continue;
+
+                // Runs may be concatenated into one profile
+                var name = entry.Substring(separator + 1);
+                _counts[name] = _counts.GetValueOrDefault(name) + count;
+            }
+
+            var total = _counts.Values.Sum();
+            long covered = 0;
+            foreach (var method in _counts.OrderByDescending(x => x.Value).ThenBy(x => x.Key, StringComparer.Ordinal))
+            {
+                if (covered >= total * HotCoverage)
+                    break;
+
+                _hotRanks.Add(method.Key, _hotRanks.Count);
+                covered += method.Value;
+            }
+        }
+
+        public static string GetHotSection(MethodDef method)
+        {
+            return _hotRanks.TryGetValue(method.FullName, out var rank) ? $".text.natsu.hot.{rank:D5}" : null;
+        }
+
+        // Without a profile nothing is known to be cold
+        public static bool IsCold(MethodDef method)
+        {
+            return _counts != null && !_counts.ContainsKey(method.FullName);
+        }
+
+        // Included by the .text output section of board/*/chino.ld, it's written even without a profile
+        public static void WriteSectionOrder(string file)
+        {
+            var writer = new StringWriter();
+            writer.WriteLine("/* Generated by NatsuCLR Compiler, hot methods in profile order */");
+            foreach (var rank in _hotRanks.Values.OrderBy(x => x))
+                writer.WriteLine($"*(.text.natsu.hot.{rank:D5})");
+
+            var content = writer.ToString();
+            if (!File.Exists(file) || File.ReadAllText(file) != content)
+            {
+                Directory.CreateDirectory(Path.GetDirectoryName(file));
+                File.WriteAllText(file, content);
+            }
+        }
+    }
+}
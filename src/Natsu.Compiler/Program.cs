@@ -6,6 +6,7 @@ using System.Reflection.Metadata;
 using System.Runtime.CompilerServices;
 using System.Security.Cryptography;
 using System.Text;
+using System.Threading.Tasks;
 using dnlib.DotNet;
 using dnlib.DotNet.Emit;
 
@@ -27,11 +28,13 @@ namespace Natsu.Compiler
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Console.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Collections.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Memory.dll",
+            @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Numerics.Vectors.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Runtime.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Runtime.Extensions.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Diagnostics.Debug.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Diagnostics.Process.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Runtime.InteropServices.dll",
+            @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Runtime.Intrinsics.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Threading.dll",
             @"..\..\..\..\..\out\bin\netcoreapp3.0\System.Threading.Thread.dll",
             Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.UserProfile), @".nuget\packages\bitfields\0.1.0\lib\netstandard1.0\BitFields.dll")
@@ -40,28 +43,76 @@ namespace Natsu.Compiler
         static void Main(string[] args)
         {
             var ctx = ModuleDef.CreateModuleContext();
+            var modules = new List<ModuleDefMD>();
             foreach (var path in _modulePaths)
             {
                 var module = ModuleDefMD.Load(path, ctx);
-                var generator = new Generator(module);
-                generator.Generate();
+                ((AssemblyResolver)ctx.AssemblyResolver).AddToCache(module);
+                modules.Add(module);
             }
+
+            // Calls are bound against the whole module set, so every module depends on all of them,
+            // on the native sources which root the tree shaking and on the profile
+            var nativePath = Path.GetFullPath(@"..\..\..\..\Native");
+            var profilePath = Path.Combine(nativePath, "natsu.profile");
+            var inputs = modules.Select(x => x.Location).Concat(ReachabilityAnalysis.GetNativeSources(nativePath));
+            if (File.Exists(profilePath))
+                inputs = inputs.Append(profilePath);
+            string digest;
+            using (var sha256 = SHA256.Create())
+                digest = Convert.ToBase64String(sha256.ComputeHash(inputs.SelectMany(File.ReadAllBytes).ToArray()));
+
+            foreach (var module in modules)
+                ClassHierarchy.AddModule(module);
+            InterfaceIds.Assign(modules);
+            ReachabilityAnalysis.Analyze(modules, nativePath);
+            ProfileGuidedLayout.Load(profilePath);
+            ProfileGuidedLayout.WriteSectionOrder(Path.Combine(nativePath, "Generated", "natsu.order.ld"));
+            EscapeAnalysis.AnalyzeModules(modules);
+
+            // A module is generated after the modules it references, modules independent of each other are generated concurrently
+            var generations = new Dictionary<string, Task>();
+            Task Generate(ModuleDefMD module)
+            {
+                var name = module.Assembly.Name.String;
+                if (!generations.TryGetValue(name, out var task))
+                {
+                    var dependencies = (from ass in module.GetAssemblyRefs()
+                                        let refModule = modules.FirstOrDefault(x => x.Assembly.Name == ass.Name)
+                                        where refModule != null
+                                        select Generate(refModule)).ToList();
+                    task = Task.Run(async () =>
+                    {
+                        await Task.WhenAll(dependencies);
+                        new Generator(module, digest).Generate();
+                    });
+                    generations.Add(name, task);
+                }
+
+                return task;
+            }
+
+            Task.WaitAll(modules.Select(Generate).ToArray());
         }
     }
 
     class Generator
     {
         private readonly ModuleDefMD _module;
+        private readonly string _digest;
         private readonly Dictionary<TypeDef, TypeDesc> _typeDescs = new Dictionary<TypeDef, TypeDesc>();
         private readonly List<TypeDesc> _sortedTypeDescs = new List<TypeDesc>();
+        private readonly List<TypeDesc> _staticInitOrder = new List<TypeDesc>();
         private readonly CorLibTypes _corLibTypes;
         private TypeDesc _szArrayType;
-        private List<string> _userStrings = new List<string>();
+        private readonly Dictionary<TypeDef, string> _methodsBodyKeys = new Dictionary<TypeDef, string>();
         private const string DigestHeader = "// Generated by NatsuCLR Compiler, digest: ";
+        private const int ShardSize = 256 * 1024;
 
-        public Generator(ModuleDefMD module)
+        public Generator(ModuleDefMD module, string digest)
         {
             _module = module;
+            _digest = digest;
             _corLibTypes = new CorLibTypes(module);
         }
 
@@ -69,16 +120,12 @@ namespace Natsu.Compiler
         {
             var outputPath = Path.GetFullPath(@"..\..\..\..\Native\Generated");
             Directory.CreateDirectory(outputPath);
-            string digest;
+            var digest = _digest;
 
-            using (var sha256 = SHA256.Create())
-            {
-                digest = Convert.ToBase64String(sha256.ComputeHash(File.ReadAllBytes(_module.Location)));
 #if true
-                if (HasOutputUptodate(Path.Combine(outputPath, $"{_module.Assembly.Name}.h"), digest))
-                    return;
+            if (HasOutputUptodate(Path.Combine(outputPath, $"{_module.Assembly.Name}.cpp"), digest))
+                return;
 #endif
-            }
 
             foreach (var type in _module.GetTypes())
             {
@@ -90,92 +137,165 @@ namespace Natsu.Compiler
             }
 
             SortTypes();
+            SortStaticInits();
 
-            using (var writer = new StreamWriter(Path.Combine(outputPath, $"{_module.Assembly.Name}.h"), false, Encoding.UTF8))
+            var writer = new StringWriter();
+            writer.WriteLine("#pragma once");
+            if (_module.Assembly.Name == "System.Private.CoreLib")
             {
-                writer.WriteLine(DigestHeader + digest);
-                writer.WriteLine("#pragma once");
-                if (_module.Assembly.Name == "System.Private.CoreLib")
-                {
-                    writer.WriteLine("#include <natsu.typedef.h>");
-                }
-                else
-                {
-                    foreach (var ass in _module.GetAssemblyRefs())
-                        writer.WriteLine($"#include <{ass.Name}.h>");
-                }
+                writer.WriteLine("#include <natsu.typedef.h>");
+            }
+            else
+            {
+                foreach (var ass in _module.GetAssemblyRefs())
+                    writer.WriteLine($"#include <{ass.Name}.h>");
+            }
 
-                writer.WriteLine();
+            writer.WriteLine();
 
-                writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
-                writer.WriteLine("{");
-                WriteTypeForwards(writer);
-                writer.WriteLine();
-                WriteTypeForwardDeclares(writer);
-                writer.WriteLine();
-                WriteAssemblyEmbeddedCode(_module.Assembly, writer);
+            writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
+            writer.WriteLine("{");
+            WriteTypeForwards(writer);
+            writer.WriteLine();
+            WriteTypeForwardDeclares(writer);
+            writer.WriteLine();
+            WriteAssemblyEmbeddedCode(_module.Assembly, writer);
+            writer.WriteLine();
+            WriteTypeDeclares(writer);
+            writer.WriteLine();
+            writer.Ident(1).WriteLine("void init_statics();");
+            writer.WriteLine("}");
+            writer.WriteLine();
+
+            if (_module.Assembly.Name == "System.Private.CoreLib")
+            {
+                writer.WriteLine("#include <natsu.runtime.h>");
                 writer.WriteLine();
-                WriteTypeDeclares(writer);
-                writer.WriteLine("}");
+            }
+            else if (_module.Assembly.Name == "Chino.Core")
+            {
+                writer.WriteLine("#include <chino.runtime.h>");
                 writer.WriteLine();
+            }
 
-                if (_module.Assembly.Name == "System.Private.CoreLib")
-                {
-                    writer.WriteLine("#include <natsu.runtime.h>");
-                    writer.WriteLine();
-                }
-                else if (_module.Assembly.Name == "Chino.Core")
-                {
-                    writer.WriteLine("#include <chino.runtime.h>");
-                    writer.WriteLine();
-                }
-
-                using (var writerSrc = new StreamWriter(Path.Combine(outputPath, $"{_module.Assembly.Name}.cpp"), false, Encoding.UTF8))
-                {
-                    writerSrc.WriteLine(DigestHeader + digest);
-                    writerSrc.WriteLine($"#include \"{_module.Assembly.Name}.h\"");
-                    writerSrc.WriteLine();
-
-                    writerSrc.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
-                    writerSrc.WriteLine("{");
-                    WriteTypeMethodsBody(writerSrc, false);
-                    writerSrc.WriteLine("}");
-                }
-
-                var hBody = new StringWriter();
+            WriteShards(Path.Combine(outputPath, _module.Assembly.Name), ImportTypeMethodsBodies(false));
 
-                hBody.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
-                hBody.WriteLine("{");
-                WriteTypeMethodsBody(hBody, true);
-                hBody.WriteLine("}");
+            var headerBodies = ImportTypeMethodsBodies(true);
+            writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
+            writer.WriteLine("{");
+            WriteUserStrings(writer, headerBodies);
+            writer.WriteLine("}");
 
-                writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
-                writer.WriteLine("{");
-                WriteUserStrings(writer);
-                writer.WriteLine("}");
-
-                writer.WriteLine();
-                writer.WriteLine(hBody.ToString());
+            writer.WriteLine();
+            writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
+            writer.WriteLine("{");
+            foreach (var body in headerBodies)
+                writer.Write(body.Writer.ToString());
+            writer.WriteLine("}");
+            WriteFileIfChanged(Path.Combine(outputPath, $"{_module.Assembly.Name}.h"), writer.ToString());
+
+            // The static inits source carries the digest of the inputs, it's written last so an interrupted run is redone
+            using (var writerSrc = new StreamWriter(Path.Combine(outputPath, $"{_module.Assembly.Name}.cpp"), false, Encoding.UTF8))
+            {
+                writerSrc.WriteLine(DigestHeader + digest);
+                writerSrc.WriteLine($"#include \"{_module.Assembly.Name}.h\"");
+                writerSrc.WriteLine();
+
+                writerSrc.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
+                writerSrc.WriteLine("{");
+                WriteStaticInits(writerSrc);
+                writerSrc.WriteLine("}");
             }
         }
 
         private bool HasOutputUptodate(string file, string digest)
+        {
+            return ReadDigest(file) == digest;
+        }
+
+        private static string ReadDigest(string file)
         {
             try
             {
                 using (var sr = new StreamReader(file, Encoding.UTF8))
                 {
-                    var fileDigest = sr.ReadLine().Split(DigestHeader)[1];
-                    return fileDigest == digest;
+                    return sr.ReadLine().Split(DigestHeader)[1];
                 }
             }
             catch (Exception)
             {
-                return false;
+                return null;
             }
         }
 
-        private void WriteAssemblyEmbeddedCode(AssemblyDef assembly, StreamWriter writer)
+        // Outputs are only rewritten when their content changes, so the C++ build doesn't recompile unchanged files
+        private static void WriteFileIfChanged(string file, string content)
+        {
+            string digest;
+            using (var sha256 = SHA256.Create())
+                digest = Convert.ToBase64String(sha256.ComputeHash(Encoding.UTF8.GetBytes(content)));
+
+            if (ReadDigest(file) != digest)
+                File.WriteAllText(file, DigestHeader + digest + Environment.NewLine + content, Encoding.UTF8);
+        }
+
+        // Non generic method bodies are split into translation units by namespace, namespaces larger than
+        // ShardSize are split further, so that the C++ build can compile them in parallel and incrementally
+        private void WriteShards(string shardsPath, List<MethodsBody> bodies)
+        {
+            Directory.CreateDirectory(shardsPath);
+            var shards = new Dictionary<string, List<MethodsBody>>();
+            foreach (var group in bodies.Where(x => x.Writer.GetStringBuilder().Length != 0).GroupBy(x => GetShardNamespace(x.Type.TypeDef)))
+            {
+                var ns = string.IsNullOrEmpty(group.Key) ? "global" : group.Key;
+                var shard = new List<MethodsBody>();
+                int size = 0, index = 0;
+                foreach (var body in group)
+                {
+                    var length = body.Writer.GetStringBuilder().Length;
+                    if (size != 0 && size + length > ShardSize)
+                    {
+                        shards.Add($"{ns}_{index++}", shard);
+                        shard = new List<MethodsBody>();
+                        size = 0;
+                    }
+
+                    shard.Add(body);
+                    size += length;
+                }
+
+                shards.Add($"{ns}_{index}", shard);
+            }
+
+            foreach (var shard in shards)
+            {
+                var writer = new StringWriter();
+                writer.WriteLine($"#include \"{_module.Assembly.Name}.h\"");
+                writer.WriteLine();
+                writer.WriteLine($"namespace {TypeUtils.EscapeModuleName(_module)}");
+                writer.WriteLine("{");
+                WriteUserStrings(writer, shard.Value);
+                foreach (var body in shard.Value)
+                    writer.Write(body.Writer.ToString());
+                writer.WriteLine("}");
+                WriteFileIfChanged(Path.Combine(shardsPath, shard.Key + ".cpp"), writer.ToString());
+            }
+
+            foreach (var file in Directory.GetFiles(shardsPath, "*.cpp"))
+            {
+                if (!shards.ContainsKey(Path.GetFileNameWithoutExtension(file)))
+                    File.Delete(file);
+            }
+        }
+
+        private static string GetShardNamespace(TypeDef type)
+        {
+            while (type.DeclaringType != null)
+                type = type.DeclaringType;
+            return type.Namespace.String;
+        }
+
+        private void WriteAssemblyEmbeddedCode(AssemblyDef assembly, TextWriter writer)
         {
             foreach (var att in assembly.CustomAttributes.FindAll("Natsu.AssemblyEmbeddedCodeAttribute"))
             {
@@ -183,11 +303,12 @@ namespace Natsu.Compiler
             }
         }
 
-        private void WriteUserStrings(StreamWriter writer)
+        private void WriteUserStrings(TextWriter writer, List<MethodsBody> bodies)
         {
-            for (int i = 0; i < _userStrings.Count; i++)
+            foreach (var body in bodies)
             {
-                writer.Ident(1).WriteLine($"static const constexpr auto user_string_{i} = ::natsu::make_string_literal(uR\"NS({_userStrings[i]})NS\");");
+                for (int i = 0; i < body.UserStrings.Count; i++)
+                    writer.Ident(1).WriteLine($"static const constexpr auto {body.UserStringPrefix}{i} = ::natsu::make_string_literal(uR\"NS({body.UserStrings[i]})NS\");");
             }
 
             writer.WriteLine();
@@ -226,6 +347,94 @@ namespace Natsu.Compiler
                 VisitType(type);
         }
 
+        private static bool HasStaticStruct(TypeDef type)
+        {
+            return (!type.IsEnum && type.Fields.Any(x => x.IsStatic && !x.HasConstant))
+                || type.Methods.Any(x => x.IsStaticConstructor);
+        }
+
+        private void SortStaticInits()
+        {
+            foreach (var type in GetStaticInitOrder(_sortedTypeDescs.Select(x => x.TypeDef), _module))
+                _staticInitOrder.Add(_typeDescs[type]);
+        }
+
+        // Orders the eager statics so a cctor runs after the cctors of the types whose statics it reaches
+        internal static List<TypeDef> GetStaticInitOrder(IEnumerable<TypeDef> types, ModuleDef module)
+        {
+            var eagerTypes = types.Where(x => !x.HasGenericParameters && HasStaticStruct(x)).ToList();
+            var eagerSet = new HashSet<TypeDef>(eagerTypes);
+            var order = new List<TypeDef>();
+
+            HashSet<TypeDef> GetStaticDeps(TypeDef type)
+            {
+                var deps = new HashSet<TypeDef>();
+                var cctor = type.FindStaticConstructor();
+                if (cctor == null)
+                    return deps;
+
+                var visited = new HashSet<MethodDef>();
+                var pending = new Stack<MethodDef>();
+                pending.Push(cctor);
+                while (pending.Count != 0)
+                {
+                    var method = pending.Pop();
+                    if (!visited.Add(method) || !method.HasBody)
+                        continue;
+
+                    foreach (var inst in method.Body.Instructions)
+                    {
+                        switch (inst.OpCode.Code)
+                        {
+                            case Code.Ldsfld:
+                            case Code.Ldsflda:
+                            case Code.Stsfld:
+                                {
+                                    var fieldType = ((IField)inst.Operand).DeclaringType.ResolveTypeDef();
+                                    if (fieldType != null && fieldType != type && eagerSet.Contains(fieldType))
+                                        deps.Add(fieldType);
+                                    break;
+                                }
+                            case Code.Call:
+                            case Code.Callvirt:
+                            case Code.Newobj:
+                            case Code.Ldftn:
+                                {
+                                    var callee = ((IMethod)inst.Operand).ResolveMethodDef();
+                                    if (callee != null && inst.OpCode.Code == Code.Callvirt)
+                                        callee = ClassHierarchy.FindSingleTarget(callee);
+                                    if (callee != null && callee.Module == module)
+                                    {
+                                        pending.Push(callee);
+                                        if (callee.DeclaringType != type && eagerSet.Contains(callee.DeclaringType))
+                                            deps.Add(callee.DeclaringType);
+                                    }
+                                    break;
+                                }
+                        }
+                    }
+                }
+
+                return deps;
+            }
+
+            // Cycles are broken at the back edge, like the CLR runs a cctor that is already running
+            var visitedTypes = new HashSet<TypeDef>();
+            void VisitType(TypeDef type)
+            {
+                if (visitedTypes.Add(type))
+                {
+                    foreach (var dep in GetStaticDeps(type))
+                        VisitType(dep);
+                    order.Add(type);
+                }
+            }
+
+            foreach (var type in eagerTypes)
+                VisitType(type);
+            return order;
+        }
+
         private TypeDef GetTypeDef(ITypeDefOrRef type)
         {
             var typeDef = type as TypeDef;
@@ -347,7 +556,7 @@ namespace Natsu.Compiler
             }
         }
 
-        private void WriteTypeForwards(StreamWriter writer)
+        private void WriteTypeForwards(TextWriter writer)
         {
             var types = _module.ExportedTypes.Where(x => x.Attributes == TypeAttributes.Forwarder).ToList();
             var index = 0;
@@ -362,7 +571,7 @@ namespace Natsu.Compiler
                 writer.WriteLine();
         }
 
-        private void WriteTypeForward(StreamWriter writer, int ident, dnlib.DotNet.ExportedType type)
+        private void WriteTypeForward(TextWriter writer, int ident, dnlib.DotNet.ExportedType type)
         {
             var nss = type.Namespace.Split('.', StringSplitOptions.RemoveEmptyEntries)
                 .Select(TypeUtils.EscapeNamespaceName).ToList();
@@ -390,7 +599,7 @@ namespace Natsu.Compiler
         }
 
         #region Forward Declares
-        private void WriteTypeForwardDeclares(StreamWriter writer)
+        private void WriteTypeForwardDeclares(TextWriter writer)
         {
             var types = _typeDescs.Values.ToList();
             var index = 0;
@@ -402,7 +611,7 @@ namespace Natsu.Compiler
             }
         }
 
-        private void WriteTypeForwardDeclare(StreamWriter writer, int ident, TypeDesc type)
+        private void WriteTypeForwardDeclare(TextWriter writer, int ident, TypeDesc type)
         {
             var nss = TypeUtils.GetNamespace(type.TypeDef).Split('.', StringSplitOptions.RemoveEmptyEntries)
                 .Select(TypeUtils.EscapeNamespaceName).ToList();
@@ -426,7 +635,7 @@ namespace Natsu.Compiler
 
         #region Declares
 
-        private void WriteTypeDeclares(StreamWriter writer)
+        private void WriteTypeDeclares(TextWriter writer)
         {
             var index = 0;
             foreach (var type in _sortedTypeDescs)
@@ -437,7 +646,7 @@ namespace Natsu.Compiler
             }
         }
 
-        private void WriteTypeDeclare(StreamWriter writer, int ident, TypeDesc type)
+        private void WriteTypeDeclare(TextWriter writer, int ident, TypeDesc type)
         {
             bool hasStaticMember = false;
 
@@ -631,7 +840,7 @@ namespace Natsu.Compiler
             writer.WriteLine();
         }
 
-        private void WriteTypeInfo(StreamWriter writer, int ident, TypeDesc type)
+        private void WriteTypeInfo(TextWriter writer, int ident, TypeDesc type)
         {
             writer.Ident(ident).WriteLine($"struct TypeInfo");
             writer.Ident(ident).WriteLine("{");
@@ -639,11 +848,100 @@ namespace Natsu.Compiler
             writer.Ident(ident + 1).WriteLine($"static constexpr bool IsValueType = {type.TypeDef.IsValueType.ToString().ToLower()};");
             // IsEnum
             writer.Ident(ident + 1).WriteLine($"static constexpr bool IsEnum = {type.TypeDef.IsEnum.ToString().ToLower()};");
+            // GCRefs
+            WriteGCRefs(writer, ident + 1, type, false);
+            // IsBitwiseEquatable
+            WriteIsBitwiseEquatable(writer, ident + 1, type);
 
             writer.Ident(ident).WriteLine("};");
         }
 
-        private void WriteVTableDeclare(StreamWriter writer, int ident, TypeDesc type)
+        private void WriteIsBitwiseEquatable(TextWriter writer, int ident, TypeDesc type)
+        {
+            writer.Ident(ident).WriteLine("static constexpr bool IsBitwiseEquatable() noexcept");
+            writer.Ident(ident).WriteLine("{");
+            writer.Ident(ident + 1).WriteLine($"return {GetIsBitwiseEquatable(type.TypeDef, type.Name.String)};");
+            writer.Ident(ident).WriteLine("}");
+        }
+
+        // Values of the type are equal exactly when their bytes are, so comparisons can use memcmp
+        internal static string GetIsBitwiseEquatable(TypeDef typeDef, string typeName)
+        {
+            var conditions = new List<string>();
+            if (!typeDef.IsValueType || typeDef.IsExplicitLayout)
+            {
+                conditions.Add("false");
+            }
+            else if (typeDef.IsEnum)
+            {
+                conditions.Add("true");
+            }
+            else if (typeDef.IsPrimitive)
+            {
+                var elementType = typeDef.ToTypeSig().ElementType;
+                conditions.Add(elementType == ElementType.R4 || elementType == ElementType.R8 ? "false" : "true");
+            }
+            else if (typeDef.Methods.Any(x => x.Name == "Equals" && !x.IsStatic)
+                || typeDef.Interfaces.Any(x => x.Interface.FullName.StartsWith("System.IEquatable`1")))
+            {
+                conditions.Add("false");
+            }
+            else
+            {
+                // Same rule as ValueType.Equals comparing bits: no padding and no field with its own equality
+                conditions.Add($"std::has_unique_object_representations_v<{typeName}>");
+                foreach (var field in typeDef.Fields)
+                {
+                    if (!field.IsStatic && !field.HasConstant)
+                        conditions.Add($"::natsu::is_bitwise_equatable_v<decltype({typeName}::{TypeUtils.EscapeIdentifier(field.Name)})>");
+                }
+            }
+
+            return string.Join(" && ", conditions);
+        }
+
+        private void WriteGCRefs(TextWriter writer, int ident, TypeDesc type, bool isStatic)
+        {
+            var typeName = isStatic ? "Static" : type.Name.String;
+            var refs = new List<string>();
+
+            if (!isStatic && !type.TypeDef.IsValueType)
+            {
+                var baseType = GetBaseType(type.TypeDef);
+                if (baseType != null)
+                    refs.Add($"::natsu::gc_refs_of<{TypeUtils.EscapeTypeName(baseType)}>::get()");
+            }
+
+            if (!type.TypeDef.IsEnum)
+            {
+                foreach (var field in type.TypeDef.Fields)
+                {
+                    if (field.IsStatic == isStatic && !field.HasConstant && TypeUtils.MayContainGCRefs(field.FieldType))
+                    {
+                        var fieldName = TypeUtils.EscapeIdentifier(field.Name);
+                        // ByReference<T> keeps its byref in an IntPtr, so Span<T> and friends report it as one
+                        var fieldType = type.TypeDef.FullName == "System.ByReference`1" ? "::natsu::gc_ref<uint8_t>" : $"decltype({typeName}::{fieldName})";
+                        refs.Add($"::natsu::gc_field_refs<{fieldType}>(offsetof({typeName}, {fieldName}))");
+                    }
+                }
+            }
+
+            writer.Ident(ident).WriteLine("static constexpr auto GCRefs() noexcept");
+            writer.Ident(ident).WriteLine("{");
+            if (refs.Count == 0)
+            {
+                writer.Ident(ident + 1).WriteLine("return ::natsu::gc_refs_concat();");
+            }
+            else
+            {
+                writer.Ident(ident + 1).WriteLine("return ::natsu::gc_refs_concat(");
+                for (int i = 0; i < refs.Count; i++)
+                    writer.Ident(ident + 2).WriteLine(refs[i] + (i == refs.Count - 1 ? ");" : ","));
+            }
+            writer.Ident(ident).WriteLine("}");
+        }
+
+        private void WriteVTableDeclare(TextWriter writer, int ident, TypeDesc type)
         {
             writer.Ident(ident).Write($"struct VTable");
             if (!type.TypeDef.IsInterface)
@@ -674,6 +972,8 @@ namespace Natsu.Compiler
                 writer.WriteLine();
 
                 writer.Ident(ident).WriteLine("{");
+                writer.Ident(ident + 1).WriteLine($"static constexpr uint32_t InterfaceId = {InterfaceIds.GetId(type.TypeDef)}u;");
+                writer.WriteLine();
             }
 
             WriteVTableCtor(writer, type, ident + 1);
@@ -682,6 +982,12 @@ namespace Natsu.Compiler
             WriteVTableOverrideImpl(writer, type, ident + 1);
             writer.WriteLine();
 
+            if (type.TypeDef.IsInterface)
+                WriteVTableEquals(writer, type, ident + 1);
+            else
+                WriteVTableOverrideItable(writer, type, ident + 1);
+            writer.WriteLine();
+
             foreach (var method in type.TypeDef.Methods)
             {
                 if (!method.IsInstanceConstructor && !method.IsStatic)
@@ -691,7 +997,7 @@ namespace Natsu.Compiler
             writer.Ident(ident).WriteLine("};");
         }
 
-        private void WriteStatic(StreamWriter writer, int ident, TypeDesc type)
+        private void WriteStatic(TextWriter writer, int ident, TypeDesc type)
         {
             if (type.TypeDef.HasGenericParameters)
             {
@@ -709,6 +1015,13 @@ namespace Natsu.Compiler
             writer.WriteLine("::Static");
             writer.Ident(ident).WriteLine("{");
 
+            // TypeInfo
+            writer.Ident(ident + 1).WriteLine("struct TypeInfo");
+            writer.Ident(ident + 1).WriteLine("{");
+            WriteGCRefs(writer, ident + 2, type, true);
+            writer.Ident(ident + 1).WriteLine("};");
+            writer.WriteLine();
+
             foreach (var field in type.TypeDef.Fields)
             {
                 if (field.IsStatic && !field.HasConstant)
@@ -726,7 +1039,7 @@ namespace Natsu.Compiler
             writer.Ident(ident).WriteLine("};");
         }
 
-        private void WriteField(StreamWriter writer, int ident, FieldDef value, bool isStatic = false)
+        private void WriteField(TextWriter writer, int ident, FieldDef value, bool isStatic = false)
         {
             string prefix = string.Empty;
             if (value.IsStatic && !isStatic)
@@ -802,7 +1115,7 @@ namespace Natsu.Compiler
             }
         }
 
-        private void WriteConstantField(StreamWriter writer, int ident, FieldDef value)
+        private void WriteConstantField(TextWriter writer, int ident, FieldDef value)
         {
             string prefix = string.Empty;
             if (value.IsStatic)
@@ -823,16 +1136,83 @@ namespace Natsu.Compiler
         }
         #endregion
 
-        private void WriteTypeMethodsBody(TextWriter writer, bool inHeader)
+        private void WriteStaticInits(TextWriter writer)
         {
-            foreach (var type in _sortedTypeDescs)
+            writer.Ident(1).WriteLine("void init_statics()");
+            writer.Ident(1).WriteLine("{");
+            writer.Ident(2).WriteLine("static bool initialized = false;");
+            writer.Ident(2).WriteLine("if (initialized)");
+            writer.Ident(3).WriteLine("return;");
+            writer.Ident(2).WriteLine("initialized = true;");
+            writer.WriteLine();
+
+            foreach (var ass in _module.GetAssemblyRefs())
+                writer.Ident(2).WriteLine($"::{TypeUtils.EscapeModuleName(ass)}::init_statics();");
+
+            foreach (var type in _staticInitOrder)
+            {
+                // The cctor of an unused type is tree shaken, its statics are never accessed
+                var cctor = type.TypeDef.FindStaticConstructor();
+                if (cctor != null && !IsEmitted(cctor))
+                    continue;
+
+                writer.Ident(2).WriteLine($"::natsu::static_storage<typename {TypeUtils.EscapeTypeName(type.TypeDef)}::Static>::init();");
+            }
+            writer.Ident(1).WriteLine("}");
+        }
+
+        // Output of the method bodies of one type, user strings and frozen objects are named after the type's
+        // key so that bodies can be generated independently and keep their names when other types change
+        private class MethodsBody
+        {
+            public string Key { get; }
+
+            public TypeDesc Type { get; }
+
+            public StringWriter Writer { get; } = new StringWriter();
+
+            public List<string> UserStrings { get; } = new List<string>();
+
+            public int FrozenObjects { get; set; }
+
+            public string UserStringPrefix => $"user_string_{Key}_";
+
+            public MethodsBody(string key, TypeDesc type)
+            {
+                Key = key;
+                Type = type;
+            }
+        }
+
+        // Types are imported in parallel, the bodies are returned in sorted order so the output doesn't depend on scheduling
+        private List<MethodsBody> ImportTypeMethodsBodies(bool inHeader)
+        {
+            if (_methodsBodyKeys.Count == 0)
+                AssignMethodsBodyKeys();
+
+            // Header bodies are seen by every shard, so they get names of their own
+            var bodies = _sortedTypeDescs.Select(x => new MethodsBody((inHeader ? "h" : string.Empty) + _methodsBodyKeys[x.TypeDef], x)).ToList();
+
+            bodies.AsParallel().ForAll(x => WriteTypeMethodBody(x, 0, x.Type, inHeader));
+            return bodies;
+        }
+
+        // Keys hash the type name, a collision rehashes the type that comes later by name
+        private void AssignMethodsBodyKeys()
+        {
+            var used = new HashSet<uint>();
+            foreach (var type in _sortedTypeDescs.Select(x => x.TypeDef).OrderBy(x => x.FullName, StringComparer.Ordinal))
             {
-                WriteTypeMethodBody(writer, 0, type, inHeader);
+                var hash = TypeUtils.StableHash(type.FullName);
+                while (!used.Add(hash))
+                    hash = hash * 16777619u + 1;
+                _methodsBodyKeys.Add(type, hash.ToString("x8"));
             }
         }
 
-        private void WriteTypeMethodBody(TextWriter writer, int ident, TypeDesc type, bool inHeader)
+        private void WriteTypeMethodBody(MethodsBody body, int ident, TypeDesc type, bool inHeader)
         {
+            var writer = body.Writer;
             if (!type.TypeDef.IsAbstract && !type.TypeDef.IsInterface)
             {
                 if (inHeader == type.TypeDef.HasGenericParameters)
@@ -850,17 +1230,32 @@ namespace Natsu.Compiler
                     }
 
                     if (!method.IsAbstract && !method.IsInternalCall
-                        && (method.HasBody || method.IsRuntime))
+                        && (method.HasBody || method.IsRuntime) && IsEmitted(method))
                     {
-                        WriteMethodBody(writer, ident, method);
+                        WriteMethodBody(body, ident, method);
                         writer.WriteLine();
                     }
                 }
             }
         }
 
-        private void WriteMethodBody(TextWriter writer, int ident, MethodDef method)
+        // Templates are only instantiated where they are used, so only the bodies of non generic methods are tree shaken
+        private static bool IsEmitted(MethodDef method)
         {
+            return method.DeclaringType.HasGenericParameters || method.HasGenericParameters || ReachabilityAnalysis.IsReachable(method);
+        }
+
+        private void WriteMethodBody(MethodsBody body, int ident, MethodDef method)
+        {
+            var writer = body.Writer;
+            List<string> frozenInits = null;
+            if (method.IsStaticConstructor && !method.DeclaringType.HasGenericParameters)
+            {
+                var frozenFields = StaticEvaluator.TryEvaluate(method);
+                if (frozenFields != null)
+                    frozenInits = WriteFrozenObjects(body, ident, frozenFields);
+            }
+
             writer.Ident(ident);
             var typeGens = new List<string>();
             var methodGens = new List<string>();
@@ -875,6 +1270,17 @@ namespace Natsu.Compiler
             if (methodGens.Any())
                 writer.WriteLine($"template <{string.Join(", ", methodGens.Select(x => "class " + x))}>");
 
+            // Only bodies in the sources are profiled and laid out, templates are instantiated all over
+            var isProfiled = !typeGens.Any() && !methodGens.Any();
+            if (isProfiled)
+            {
+                var hotSection = ProfileGuidedLayout.GetHotSection(method);
+                if (hotSection != null)
+                    writer.Write($"NATSU_HOT(\"{hotSection}\") ");
+                else if (ProfileGuidedLayout.IsCold(method))
+                    writer.Write("NATSU_COLD ");
+            }
+
             if (!method.IsStaticConstructor)
                 writer.Write(TypeUtils.EscapeVariableTypeName(method.ReturnType) + " ");
             writer.Write(TypeUtils.EscapeTypeName(method.DeclaringType, hasModuleName: false));
@@ -884,8 +1290,15 @@ namespace Natsu.Compiler
             WriteParameterList(writer, method.Parameters);
             writer.WriteLine(")");
             writer.Ident(ident).WriteLine("{");
-            if (method.HasBody)
-                WriteILBody(writer, ident + 1, method);
+            if (isProfiled)
+                writer.Ident(ident + 1).WriteLine($"NATSU_PROFILE_ENTRY(R\"NS({method.FullName})NS\");");
+            if (frozenInits != null)
+            {
+                foreach (var init in frozenInits)
+                    writer.Ident(ident + 1).WriteLine(init);
+            }
+            else if (method.HasBody)
+                WriteILBody(body, ident + 1, method);
             else if (method.IsRuntime)
                 WriteRuntimeBody(writer, ident + 1, method);
             else
@@ -894,7 +1307,62 @@ namespace Natsu.Compiler
             writer.Flush();
         }
 
-        private void WriteVTableCtor(StreamWriter writer, TypeDesc type, int ident)
+        // Objects a cctor evaluated at compile time creates are constant initialized, the cctor only stores them
+        private List<string> WriteFrozenObjects(MethodsBody body, int ident, Dictionary<FieldDef, object> fields)
+        {
+            var writer = body.Writer;
+            var objects = new Dictionary<object, string>();
+            string GetObject(object value)
+            {
+                if (!objects.TryGetValue(value, out var name))
+                {
+                    name = $"_frozen_{body.Key}_{body.FrozenObjects++}";
+                    if (value is string str)
+                    {
+                        writer.Ident(ident).WriteLine($"static const constexpr auto {name} = ::natsu::make_string_literal(uR\"NS({str})NS\");");
+                    }
+                    else
+                    {
+                        // Arrays stay writable like any other array, so they are placed in data instead of rodata
+                        var array = (FrozenArray)value;
+                        var elementType = TypeUtils.EscapeTypeName(array.ElementType, cppBasicType: true);
+                        var elements = string.Join(", ", array.Elements.Select(FrozenLiteral));
+                        writer.Ident(ident).WriteLine($"static auto {name} = ::natsu::make_szarray_literal(std::array<{elementType}, {array.Elements.Length}> {{ {elements} }});");
+                    }
+
+                    objects.Add(value, name);
+                }
+
+                return name;
+            }
+
+            var inits = new List<string>();
+            foreach (var field in fields)
+            {
+                var fieldName = TypeUtils.EscapeIdentifier(field.Key.Name);
+                if (field.Value == null)
+                    inits.Add($"{fieldName} = nullptr;");
+                else if (field.Value is string || field.Value is FrozenArray)
+                    inits.Add($"{fieldName} = {GetObject(field.Value)}.get();");
+                else if (field.Key.FieldType.ElementType == ElementType.ValueType)
+                    inits.Add($"{fieldName}.value__ = static_cast<decltype({fieldName}.value__)>({FrozenLiteral(field.Value)});");
+                else
+                    inits.Add($"{fieldName} = {FrozenLiteral(field.Value)};");
+            }
+
+            if (objects.Count != 0)
+                writer.WriteLine();
+            return inits;
+        }
+
+        private static string FrozenLiteral(object value)
+        {
+            if (value is bool b)
+                return b ? "true" : "false";
+            return TypeUtils.LiteralConstant(value);
+        }
+
+        private void WriteVTableCtor(TextWriter writer, TypeDesc type, int ident)
         {
             bool firstInit = true;
             writer.Ident(ident).WriteLine("constexpr VTable()");
@@ -934,7 +1402,8 @@ namespace Natsu.Compiler
                     {
                         if (method.Name.Contains("."))
                         {
-                            foreach (var ov in method.Overrides)
+                            // Interface slots are filled in by override_itable
+                            foreach (var ov in method.Overrides.Where(x => !IsInterfaceMethod(x.MethodDeclaration)))
                             {
                                 writer.Ident(ident + 1).Write(TypeUtils.EscapeTypeName(ov.MethodDeclaration.DeclaringType, cppBasicType: true));
                                 writer.Write("::VTable::");
@@ -956,16 +1425,26 @@ namespace Natsu.Compiler
             writer.Ident(ident).WriteLine("}");
         }
 
-        private void WriteVTableTypeInfo(StreamWriter writer, TypeDesc type, int ident)
+        private void WriteVTableTypeInfo(TextWriter writer, TypeDesc type, int ident)
         {
             // array
             if (type.TypeDef.FullName == "System.SZArray`1")
             {
-                writer.Ident(ident).WriteLine("ElementSize = sizeof(T);");
+                writer.Ident(ident).WriteLine("ElementSize = sizeof(::natsu::variable_type_t<T>);");
+                writer.Ident(ident).WriteLine("GCRefs = ::natsu::gc_refs_holder<::natsu::variable_type_t<T>>::value.data();");
+                writer.Ident(ident).WriteLine("GCRefsCount = (uint32_t)::natsu::gc_refs_holder<::natsu::variable_type_t<T>>::value.size();");
             }
+            else if (!type.TypeDef.IsInterface)
+            {
+                writer.Ident(ident).WriteLine($"GCRefs = ::natsu::gc_refs_holder<{type.Name}>::value.data();");
+                writer.Ident(ident).WriteLine($"GCRefsCount = (uint32_t)::natsu::gc_refs_holder<{type.Name}>::value.size();");
+            }
+
+            if (!type.TypeDef.IsInterface)
+                writer.Ident(ident).WriteLine("::natsu::init_type_hierarchy<VTable>(*this);");
         }
 
-        private void WriteVTableOverrideImpl(StreamWriter writer, TypeDesc type, int ident)
+        private void WriteVTableOverrideImpl(TextWriter writer, TypeDesc type, int ident)
         {
             writer.Ident(ident).WriteLine("template <class TFunc>");
             writer.Ident(ident).WriteLine("constexpr void override_vfunc_impl(std::string_view name, TFunc func)");
@@ -993,6 +1472,56 @@ namespace Natsu.Compiler
             }
         }
 
+        private static bool IsInterfaceMethod(IMethod method)
+        {
+            return method.DeclaringType.ResolveTypeDef()?.IsInterface == true;
+        }
+
+        // Interface vtables are built apart from the class vtable, each class from System.Object down overrides the
+        // slots by name and explicit implementations override their own interface last
+        private void WriteVTableOverrideItable(TextWriter writer, TypeDesc type, int ident)
+        {
+            writer.Ident(ident).WriteLine("template <class TIFace>");
+            writer.Ident(ident).WriteLine("static constexpr void override_itable(TIFace &itable) noexcept");
+            writer.Ident(ident).WriteLine("{");
+            writer.Ident(ident + 1).WriteLine("base_t::override_itable(itable);");
+
+            var methods = type.TypeDef.Methods.Where(x => !x.IsInstanceConstructor && !x.IsStatic && x.IsVirtual).ToList();
+            foreach (var method in methods.Where(x => !x.Name.Contains(".")))
+            {
+                writer.Ident(ident + 1).Write("itable.override_vfunc_impl");
+                writer.Write("(R\"NS(" + method.Name + ")NS\", ");
+                writer.WriteLine("_imp_" + TypeUtils.EscapeMethodName(method) + ");");
+            }
+
+            foreach (var method in methods.Where(x => x.Name.Contains(".")))
+            {
+                foreach (var ov in method.Overrides.Where(x => IsInterfaceMethod(x.MethodDeclaration)))
+                {
+                    writer.Ident(ident + 1).WriteLine($"if constexpr (std::is_same_v<TIFace, typename {TypeUtils.EscapeTypeName(ov.MethodDeclaration.DeclaringType, cppBasicType: true)}::VTable>)");
+                    writer.Ident(ident + 2).WriteLine($"itable.{TypeUtils.EscapeMethodName(ov.MethodDeclaration)} = _imp_{TypeUtils.EscapeMethodName(method, hasExplicit: true)};");
+                }
+            }
+
+            writer.Ident(ident).WriteLine("}");
+        }
+
+        // Lets a derived class share the interface vtable of its base when it overrides none of the slots
+        private void WriteVTableEquals(TextWriter writer, TypeDesc type, int ident)
+        {
+            var slots = (from method in type.TypeDef.Methods
+                         where !method.IsStatic && method.IsVirtual && method.IsNewSlot && !method.Name.Contains(".")
+                         select TypeUtils.EscapeMethodName(method)).ToList();
+
+            writer.Ident(ident).WriteLine("constexpr bool operator==(const VTable &other) const noexcept");
+            writer.Ident(ident).WriteLine("{");
+            if (slots.Any())
+                writer.Ident(ident + 1).WriteLine("return " + string.Join(" && ", slots.Select(x => $"{x} == other.{x}")) + ";");
+            else
+                writer.Ident(ident + 1).WriteLine("return true;");
+            writer.Ident(ident).WriteLine("}");
+        }
+
         private void WriteVTableMethodDeclare(TextWriter writer, int ident, MethodDef method)
         {
             var methodGens = new List<string>();
@@ -1090,7 +1619,7 @@ namespace Natsu.Compiler
             else
                 writer.WriteLine(") const");
             writer.Ident(ident).WriteLine("{");
-            if (method.IsAbstract)
+            if (method.IsAbstract || !IsEmitted(method))
             {
                 writer.Ident(ident + 1).WriteLine("::natsu::pure_call();");
             }
@@ -1107,8 +1636,9 @@ namespace Natsu.Compiler
             writer.Flush();
         }
 
-        private void WriteILBody(TextWriter writer, int ident, MethodDef method)
+        private void WriteILBody(MethodsBody methodsBody, int ident, MethodDef method)
         {
+            var writer = methodsBody.Writer;
             var body = method.Body;
 
             foreach (var local in body.Variables)
@@ -1121,7 +1651,12 @@ namespace Natsu.Compiler
 
             }
 
-            var importer = new ILImporter(_corLibTypes, method, writer, ident) { UserStrings = _userStrings, ModuleName = TypeUtils.EscapeModuleName(_module.Assembly) };
+            var importer = new ILImporter(_corLibTypes, method, writer, ident)
+            {
+                UserStrings = methodsBody.UserStrings,
+                UserStringPrefix = methodsBody.UserStringPrefix,
+                ModuleName = TypeUtils.EscapeModuleName(_module.Assembly)
+            };
             importer.ImportNormalBlocks();
             importer.ImportExceptionBlocks();
             importer.Gencode();
@@ -0,0 +1,258 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Text.RegularExpressions;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace Natsu.Compiler
+{
+    // Rapid type analysis over the whole program, finds the methods that can be invoked starting from the entry points
+    // and from the native runtime. Virtual methods are reachable once their type is instantiated and a call names their slot.
+    static class ReachabilityAnalysis
+    {
+        private static HashSet<MethodDef> _reachable;
+        private static HashSet<TypeDef> _usedTypes;
+        private static HashSet<TypeDef> _instantiatedTypes;
+        private static HashSet<string> _calledSlots;
+        private static Dictionary<string, List<MethodDef>> _virtualsBySlot;
+        private static Stack<MethodDef> _pending;
+
+        public static bool IsReachable(MethodDef method)
+        {
+            return _reachable == null || _reachable.Contains(method);
+        }
+
+        // The native runtime calls into managed code by the escaped C++ names, so a type or method whose name appears
+        // in the native sources or the embedded code of an assembly is taken as a root
+        public static void Analyze(IEnumerable<ModuleDef> modules, string nativePath)
+        {
+            _reachable = new HashSet<MethodDef>();
+            _usedTypes = new HashSet<TypeDef>();
+            _instantiatedTypes = new HashSet<TypeDef>();
+            _calledSlots = new HashSet<string>();
+            _virtualsBySlot = new Dictionary<string, List<MethodDef>>();
+            _pending = new Stack<MethodDef>();
+
+            var types = modules.SelectMany(x => x.GetTypes()).ToList();
+            foreach (var method in types.SelectMany(x => x.Methods).Where(x => x.IsVirtual))
+            {
+                foreach (var slot in GetSlots(method).Distinct())
+                {
+                    if (!_virtualsBySlot.TryGetValue(slot, out var virtuals))
+                        _virtualsBySlot.Add(slot, virtuals = new List<MethodDef>());
+                    virtuals.Add(method);
+                }
+            }
+
+            var nativeCode = GetNativeSources(nativePath)
+                .Select(File.ReadAllText)
+                .Concat(from module in modules
+                        from att in module.Assembly.CustomAttributes.FindAll("Natsu.AssemblyEmbeddedCodeAttribute")
+                        select att.ConstructorArguments[0].Value.ToString());
+            var tokens = new HashSet<string>(nativeCode.SelectMany(x => Regex.Matches(x, "[A-Za-z_][A-Za-z0-9_]*").Select(m => m.Value)));
+
+            foreach (var token in tokens)
+                AddSlot(token);
+
+            foreach (var module in modules)
+            {
+                if (module.EntryPoint != null)
+                    Reach(module.EntryPoint);
+            }
+
+            foreach (var type in types)
+            {
+                if (!tokens.Contains(TypeUtils.EscapeTypeName(type.FullName)))
+                    continue;
+
+                Instantiate(type);
+                foreach (var method in type.Methods)
+                {
+                    if (tokens.Contains(TypeUtils.EscapeMethodName(method, hasParamType: false))
+                        || tokens.Contains(TypeUtils.EscapeMethodName(method)))
+                        Reach(method);
+                }
+            }
+
+            while (_pending.Count != 0)
+                Scan(_pending.Pop());
+        }
+
+        public static IEnumerable<string> GetNativeSources(string nativePath)
+        {
+            var generatedPath = Path.Combine(nativePath, "Generated");
+            return from file in Directory.EnumerateFiles(nativePath, "*.*", SearchOption.AllDirectories)
+                   where (file.EndsWith(".h") || file.EndsWith(".cpp")) && !file.StartsWith(generatedPath)
+                   orderby file
+                   select file;
+        }
+
+        private static IEnumerable<string> GetSlots(MethodDef method)
+        {
+            yield return method.Name.String;
+            yield return method.Name.String.Split('.').Last();
+            yield return TypeUtils.EscapeMethodName(method);
+            foreach (var ov in method.Overrides)
+                yield return ov.MethodDeclaration.Name.String;
+        }
+
+        private static void Reach(MethodDef method)
+        {
+            if (_reachable.Add(method))
+            {
+                Use(method.DeclaringType);
+                _pending.Push(method);
+            }
+        }
+
+        private static void Use(TypeDef type)
+        {
+            if (type == null || !_usedTypes.Add(type))
+                return;
+
+            var cctor = type.FindStaticConstructor();
+            if (cctor != null)
+                Reach(cctor);
+            Use(type.BaseType?.ResolveTypeDef());
+            Use(type.DeclaringType);
+            if (type.IsValueType)
+                Instantiate(type);
+        }
+
+        // Methods of a base type are dispatched to on the instances of derived types, so the whole base chain counts as instantiated.
+        // The constexpr vtable of a generic type instantiates every one of its thunks, so all of its virtuals are scanned.
+        private static void Instantiate(TypeDef type)
+        {
+            for (; type != null && _instantiatedTypes.Add(type); type = type.BaseType?.ResolveTypeDef())
+            {
+                Use(type);
+                foreach (var method in type.Methods)
+                {
+                    if (method.IsVirtual && (type.HasGenericParameters || GetSlots(method).Any(_calledSlots.Contains)))
+                        Reach(method);
+                }
+            }
+        }
+
+        private static void AddSlot(string slot)
+        {
+            if (_calledSlots.Add(slot) && _virtualsBySlot.TryGetValue(slot, out var virtuals))
+            {
+                foreach (var method in virtuals)
+                {
+                    if (_instantiatedTypes.Contains(method.DeclaringType))
+                        Reach(method);
+                }
+            }
+        }
+
+        // Generic arguments may be instantiated by the generic code, e.g. by Activator.CreateInstance<T>
+        private static void InstantiateGenericArguments(TypeSig type)
+        {
+            switch (type)
+            {
+                case GenericInstSig genericInst:
+                    foreach (var arg in genericInst.GenericArguments)
+                    {
+                        Instantiate(arg.ToTypeDefOrRef()?.ResolveTypeDef());
+                        InstantiateGenericArguments(arg);
+                    }
+                    InstantiateGenericArguments(genericInst.GenericType);
+                    break;
+                case NonLeafSig nonLeaf:
+                    InstantiateGenericArguments(nonLeaf.Next);
+                    break;
+            }
+        }
+
+        private static void Scan(MethodDef method)
+        {
+            if (!method.HasBody)
+                return;
+
+            foreach (var inst in method.Body.Instructions)
+            {
+                switch (inst.OpCode.OperandType)
+                {
+                    case OperandType.InlineMethod:
+                        ScanMethod(inst.OpCode.Code, (IMethod)inst.Operand);
+                        break;
+                    case OperandType.InlineField:
+                        ScanField((IField)inst.Operand);
+                        break;
+                    case OperandType.InlineType:
+                        ScanType(inst.OpCode.Code, (ITypeDefOrRef)inst.Operand);
+                        break;
+                    case OperandType.InlineTok:
+                        if (inst.Operand is ITypeDefOrRef type)
+                            ScanType(inst.OpCode.Code, type);
+                        else if (inst.Operand is MemberRef memberRef ? memberRef.IsFieldRef : inst.Operand is FieldDef)
+                            ScanField((IField)inst.Operand);
+                        else
+                            ScanMethod(inst.OpCode.Code, (IMethod)inst.Operand);
+                        break;
+                }
+            }
+        }
+
+        private static void ScanMethod(Code code, IMethod member)
+        {
+            if (member is MethodSpec methodSpec)
+            {
+                foreach (var arg in methodSpec.GenericInstMethodSig.GenericArguments)
+                {
+                    Instantiate(arg.ToTypeDefOrRef()?.ResolveTypeDef());
+                    InstantiateGenericArguments(arg);
+                }
+            }
+
+            if (member.DeclaringType is TypeSpec declaringSpec)
+                InstantiateGenericArguments(declaringSpec.TypeSig);
+
+            var callee = member.ResolveMethodDef();
+            if (callee == null)
+                return;
+
+            if (code == Code.Newobj)
+                Instantiate(callee.DeclaringType);
+
+            if ((code == Code.Callvirt || code == Code.Ldvirtftn) && callee.IsVirtual)
+            {
+                Use(callee.DeclaringType);
+                foreach (var slot in GetSlots(callee))
+                    AddSlot(slot);
+
+                // Devirtualized calls bind to the single target even if no instance of its type is created
+                var target = ClassHierarchy.FindSingleTarget(callee);
+                if (target != null)
+                    Reach(target);
+            }
+            else
+            {
+                Reach(callee);
+            }
+        }
+
+        private static void ScanField(IField field)
+        {
+            if (field.DeclaringType is TypeSpec declaringSpec)
+                InstantiateGenericArguments(declaringSpec.TypeSig);
+            Use(field.DeclaringType.ResolveTypeDef());
+        }
+
+        private static void ScanType(Code code, ITypeDefOrRef type)
+        {
+            if (type is TypeSpec typeSpec)
+                InstantiateGenericArguments(typeSpec.TypeSig);
+
+            var typeDef = type.ResolveTypeDef();
+            if (code == Code.Box)
+                Instantiate(typeDef);
+            else
+                Use(typeDef);
+        }
+    }
+}
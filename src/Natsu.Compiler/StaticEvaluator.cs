@@ -0,0 +1,335 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace Natsu.Compiler
+{
+    class FrozenArray
+    {
+        public TypeSig ElementType { get; }
+
+        public object[] Elements { get; }
+
+        public FrozenArray(TypeSig elementType, int length)
+        {
+            ElementType = elementType;
+            Elements = Enumerable.Repeat(Zero(elementType.ElementType), length).ToArray();
+        }
+
+        public static object Zero(ElementType type)
+        {
+            return StaticEvaluator.Convert(type, 0);
+        }
+    }
+
+    // Runs side-effect-free cctors at compile time, the statics they produce are emitted as constant initialized data.
+    // Only constant scalars, strings and arrays of primitives are frozen, enough for lookup tables and encodings.
+    // The boot time tables are not handled and still run their cctors:
+    // - Scheduler sizes its array from ChipControl.Default.ProcessorsCount and fills it with newobj Scheduler
+    // - IRQDispatcher stores a delegate into its handler array and news up a LinkedList
+    // - IOManager creates its directories through ObjectManager and news up List and Dictionary instances
+    // - NumberFormatInfo builds its invariant instance lazily on first use, not in a cctor
+    // Reference arrays and newobj graphs would need the collector to scan frozen objects, and every store into them
+    // to go through a barrier that knows about data outside the heap
+    static class StaticEvaluator
+    {
+        private const int MaxInstructions = 4096;
+        private const int MaxArrayLength = 65536;
+
+        private static readonly object Null = new object();
+
+        // Returns the final value of each static field the cctor stores, null if the cctor can't be evaluated
+        public static Dictionary<FieldDef, object> TryEvaluate(MethodDef cctor)
+        {
+            if (!cctor.HasBody || cctor.Body.HasExceptionHandlers || cctor.Body.Instructions.Count > MaxInstructions)
+                return null;
+
+            var type = cctor.DeclaringType;
+            var fields = new Dictionary<FieldDef, object>();
+            var stack = new Stack<object>();
+            foreach (var inst in cctor.Body.Instructions)
+            {
+                switch (inst.OpCode.Code)
+                {
+                    case Code.Nop:
+                        break;
+                    case Code.Ldnull:
+                        stack.Push(Null);
+                        break;
+                    case Code.Ldstr:
+                        stack.Push((string)inst.Operand);
+                        break;
+                    case Code.Ldc_I4:
+                    case Code.Ldc_I4_S:
+                    case Code.Ldc_I4_M1:
+                    case Code.Ldc_I4_0:
+                    case Code.Ldc_I4_1:
+                    case Code.Ldc_I4_2:
+                    case Code.Ldc_I4_3:
+                    case Code.Ldc_I4_4:
+                    case Code.Ldc_I4_5:
+                    case Code.Ldc_I4_6:
+                    case Code.Ldc_I4_7:
+                    case Code.Ldc_I4_8:
+                        stack.Push(inst.GetLdcI4Value());
+                        break;
+                    case Code.Ldc_I8:
+                        stack.Push((long)inst.Operand);
+                        break;
+                    case Code.Ldc_R4:
+                        stack.Push((float)inst.Operand);
+                        break;
+                    case Code.Ldc_R8:
+                        stack.Push((double)inst.Operand);
+                        break;
+                    case Code.Dup:
+                        if (stack.Count == 0)
+                            return null;
+                        stack.Push(stack.Peek());
+                        break;
+                    case Code.Pop:
+                        if (stack.Count == 0)
+                            return null;
+                        stack.Pop();
+                        break;
+                    case Code.Newarr:
+                        {
+                            var elementType = ((ITypeDefOrRef)inst.Operand).ToTypeSig();
+                            if (stack.Count == 0 || !(stack.Pop() is int length) || length < 0 || length > MaxArrayLength
+                                || !IsFrozenElementType(elementType))
+                                return null;
+                            stack.Push(new FrozenArray(elementType, length));
+                            break;
+                        }
+                    case Code.Stelem_I1:
+                    case Code.Stelem_I2:
+                    case Code.Stelem_I4:
+                    case Code.Stelem_I8:
+                    case Code.Stelem_R4:
+                    case Code.Stelem_R8:
+                        {
+                            if (stack.Count < 3)
+                                return null;
+                            var value = stack.Pop();
+                            if (!(stack.Pop() is int index) || !(stack.Pop() is FrozenArray array)
+                                || index < 0 || index >= array.Elements.Length || !IsNumber(value))
+                                return null;
+                            array.Elements[index] = Convert(array.ElementType.ElementType, value);
+                            break;
+                        }
+                    case Code.Ldtoken:
+                        {
+                            if (!(inst.Operand is FieldDef dataField) || dataField.InitialValue == null)
+                                return null;
+                            stack.Push(dataField);
+                            break;
+                        }
+                    case Code.Call:
+                        {
+                            var method = (IMethod)inst.Operand;
+                            if (method.DeclaringType.FullName != "System.Runtime.CompilerServices.RuntimeHelpers" || method.Name != "InitializeArray"
+                                || stack.Count < 2 || !(stack.Pop() is FieldDef dataField) || !(stack.Pop() is FrozenArray array)
+                                || !InitializeArray(array, dataField.InitialValue))
+                                return null;
+                            break;
+                        }
+                    case Code.Stsfld:
+                        {
+                            var field = ((IField)inst.Operand).ResolveFieldDef();
+                            if (field == null || field.DeclaringType != type || stack.Count == 0)
+                                return null;
+                            var value = stack.Pop();
+                            if (!IsStorable(field.FieldType, value))
+                                return null;
+                            fields[field] = IsNumber(value) ? Convert(GetStorageType(field.FieldType), value) : value;
+                            break;
+                        }
+                    case Code.Ldsfld:
+                        {
+                            var field = ((IField)inst.Operand).ResolveFieldDef();
+                            if (field == null || field.DeclaringType != type)
+                                return null;
+                            if (!fields.TryGetValue(field, out var value))
+                                value = IsPrimitive(GetStorageType(field.FieldType)) ? FrozenArray.Zero(GetStorageType(field.FieldType)) : Null;
+                            stack.Push(Widen(value));
+                            break;
+                        }
+                    case Code.Ret:
+                        return stack.Count == 0 ? fields.ToDictionary(x => x.Key, x => x.Value == Null ? null : x.Value) : null;
+                    default:
+                        return null;
+                }
+            }
+
+            return null;
+        }
+
+        private static bool IsNumber(object value)
+        {
+            return value is int || value is long || value is float || value is double;
+        }
+
+        private static object Widen(object value)
+        {
+            unchecked
+            {
+                return value switch
+                {
+                    bool i => i ? 1 : 0,
+                    char i => (int)i,
+                    sbyte i => (int)i,
+                    byte i => (int)i,
+                    short i => (int)i,
+                    ushort i => (int)i,
+                    uint i => (int)i,
+                    ulong i => (long)i,
+                    _ => value
+                };
+            }
+        }
+
+        private static bool IsPrimitive(ElementType type)
+        {
+            switch (type)
+            {
+                case ElementType.Boolean:
+                case ElementType.Char:
+                case ElementType.I1:
+                case ElementType.U1:
+                case ElementType.I2:
+                case ElementType.U2:
+                case ElementType.I4:
+                case ElementType.U4:
+                case ElementType.I8:
+                case ElementType.U8:
+                case ElementType.R4:
+                case ElementType.R8:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Elements of frozen arrays never hold references, the collector doesn't scan objects outside the heap
+        private static bool IsFrozenElementType(TypeSig type)
+        {
+            return IsPrimitive(type.ElementType);
+        }
+
+        private static ElementType GetStorageType(TypeSig type)
+        {
+            var typeDef = type.ToTypeDefOrRef()?.ResolveTypeDef();
+            if (typeDef != null && typeDef.IsEnum)
+                return typeDef.GetEnumUnderlyingType().ElementType;
+            return type.ElementType;
+        }
+
+        private static bool IsStorable(TypeSig fieldType, object value)
+        {
+            if (IsNumber(value))
+                return IsPrimitive(GetStorageType(fieldType));
+            if (value == Null)
+                return !fieldType.IsValueType;
+            if (value is string)
+                return fieldType.ElementType == ElementType.String;
+            if (value is FrozenArray array)
+                return fieldType is SZArraySig arraySig && new SigComparer().Equals(arraySig.Next, array.ElementType);
+            return false;
+        }
+
+        private static bool InitializeArray(FrozenArray array, byte[] data)
+        {
+            var elementType = array.ElementType.ElementType;
+            var size = GetElementSize(elementType);
+            if (data.Length < size * array.Elements.Length)
+                return false;
+
+            for (int i = 0; i < array.Elements.Length; i++)
+            {
+                var offset = i * size;
+                array.Elements[i] = elementType switch
+                {
+                    ElementType.Boolean => data[offset] != 0,
+                    ElementType.Char => (object)BitConverter.ToChar(data, offset),
+                    ElementType.I1 => (sbyte)data[offset],
+                    ElementType.U1 => data[offset],
+                    ElementType.I2 => BitConverter.ToInt16(data, offset),
+                    ElementType.U2 => BitConverter.ToUInt16(data, offset),
+                    ElementType.I4 => BitConverter.ToInt32(data, offset),
+                    ElementType.U4 => BitConverter.ToUInt32(data, offset),
+                    ElementType.I8 => BitConverter.ToInt64(data, offset),
+                    ElementType.U8 => BitConverter.ToUInt64(data, offset),
+                    ElementType.R4 => BitConverter.ToSingle(data, offset),
+                    ElementType.R8 => BitConverter.ToDouble(data, offset),
+                    _ => throw new NotSupportedException()
+                };
+            }
+
+            return true;
+        }
+
+        private static int GetElementSize(ElementType type)
+        {
+            switch (type)
+            {
+                case ElementType.Boolean:
+                case ElementType.I1:
+                case ElementType.U1:
+                    return 1;
+                case ElementType.Char:
+                case ElementType.I2:
+                case ElementType.U2:
+                    return 2;
+                case ElementType.I4:
+                case ElementType.U4:
+                case ElementType.R4:
+                    return 4;
+                default:
+                    return 8;
+            }
+        }
+
+        // Narrows an evaluation stack value the way a store to a location of the type does
+        public static object Convert(ElementType type, object value)
+        {
+            unchecked
+            {
+                long integer = value switch
+                {
+                    int i => i,
+                    long i => i,
+                    float i => (long)i,
+                    double i => (long)i,
+                    _ => 0
+                };
+
+                double real = value switch
+                {
+                    float i => i,
+                    double i => i,
+                    _ => integer
+                };
+
+                return type switch
+                {
+                    ElementType.Boolean => (object)(integer != 0),
+                    ElementType.Char => (char)integer,
+                    ElementType.I1 => (sbyte)integer,
+                    ElementType.U1 => (byte)integer,
+                    ElementType.I2 => (short)integer,
+                    ElementType.U2 => (ushort)integer,
+                    ElementType.I4 => (int)integer,
+                    ElementType.U4 => (uint)integer,
+                    ElementType.I8 => integer,
+                    ElementType.U8 => (ulong)integer,
+                    ElementType.R4 => (float)real,
+                    ElementType.R8 => real,
+                    _ => (object)integer
+                };
+            }
+        }
+    }
+}
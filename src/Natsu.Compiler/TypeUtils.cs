@@ -902,6 +902,19 @@ namespace Natsu.Compiler
             return type1 == type2 || type1.FullName == type2.FullName || type1 == type2.ScopeType;
         }
 
+        // Statics of non-generic types are constructed eagerly by the module's init_statics
+        public static bool HasEagerStatics(ITypeDefOrRef type)
+        {
+            var typeDef = type as TypeDef ?? (type as TypeRef)?.ResolveTypeDef();
+            return typeDef != null && !typeDef.HasGenericParameters;
+        }
+
+        public static string EscapeStaticFieldName(IField field)
+        {
+            var holder = HasEagerStatics(field.DeclaringType) ? "static_storage" : "static_holder";
+            return "::natsu::" + holder + "<typename" + EscapeTypeName(field.DeclaringType) + "::Static>::get()." + EscapeIdentifier(field.Name);
+        }
+
         public static string GetLocalName(Local local, MethodDef method)
         {
             string localName = null;
@@ -957,5 +970,53 @@ namespace Natsu.Compiler
                 return IsByRef(type.Next);
             return false;
         }
+
+        public static bool MayContainGCRefs(TypeSig type)
+        {
+            switch (type.ElementType)
+            {
+                case ElementType.Class:
+                case ElementType.Object:
+                case ElementType.String:
+                case ElementType.SZArray:
+                case ElementType.Array:
+                case ElementType.ValueType:
+                case ElementType.GenericInst:
+                case ElementType.Var:
+                case ElementType.MVar:
+                case ElementType.ByRef:
+                    return true;
+                case ElementType.CModReqd:
+                case ElementType.CModOpt:
+                case ElementType.Pinned:
+                    return MayContainGCRefs(type.Next);
+                default:
+                    return false;
+            }
+        }
+
+        public static bool MayContainGCRefs(StackType type)
+        {
+            switch (type.Code)
+            {
+                case StackTypeCode.O:
+                    return type.Name != "std::nullptr_t";
+                case StackTypeCode.Ref:
+                case StackTypeCode.Runtime:
+                case StackTypeCode.ValueType:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // FNV-1a of the name, unlike string.GetHashCode it is the same on every run
+        public static uint StableHash(string name)
+        {
+            var hash = 2166136261u;
+            foreach (var c in name)
+                hash = (hash ^ c) * 16777619u;
+            return hash;
+        }
     }
 }
@@ -341,7 +341,7 @@ namespace System
             nuint byteLength = (uint)length * (nuint)elementSize;
 
             if (containsGCPointers)
-                SpanHelpers.ClearWithReferences(ref Unsafe.As<byte, IntPtr>(ref ptr), byteLength / (uint)sizeof(IntPtr));
+                ClearWithReferences(array, offset, length);
             else
                 SpanHelpers.ClearWithoutReferences(ref ptr, byteLength);
         }
@@ -349,6 +349,10 @@ namespace System
         [MethodImpl(MethodImplOptions.InternalCall)]
         private static extern ref byte GetRawArrayGeometry(Array array, out uint numComponents, out uint elementSize, out int lowerBound, out bool containsGCPointers);
 
+        // Shades the references being cleared while the collector is marking
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        private static extern void ClearWithReferences(Array array, int index, int length);
+
 
         public static int LastIndexOf<T>(T[] array, T value)
         {
@@ -58,6 +58,9 @@ namespace System
 
     public static class GC
     {
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern void Collect();
+
         [MethodImplAttribute(MethodImplOptions.NoInlining)] // disable optimizations
         public static void KeepAlive(object obj)
         {
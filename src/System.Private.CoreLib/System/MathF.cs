@@ -0,0 +1,36 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*============================================================
+**
+** Purpose: Some single-precision floating-point math operations
+**
+===========================================================*/
+
+//This class contains only static members and doesn't require serialization.
+
+namespace System
+{
+    public static partial class MathF
+    {
+        public const float E = 2.71828183f;
+
+        public const float PI = 3.14159265f;
+
+        public static float Max(float x, float y)
+        {
+            return Math.Max(x, y);
+        }
+
+        public static float Min(float x, float y)
+        {
+            return Math.Min(x, y);
+        }
+
+        public static int Sign(float x)
+        {
+            return Math.Sign(x);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System.Runtime.Intrinsics;
+
+namespace System.Numerics
+{
+    /// <summary>
+    /// Contains various methods useful for creating, manipulating, combining, and converting generic vectors with one another.
+    /// </summary>
+    public static class Vector
+    {
+        /// <summary>Returns whether or not vector operations are subject to hardware acceleration.</summary>
+        public static bool IsHardwareAccelerated => Vector128.IsHardwareAccelerated;
+
+        public static Vector<T> Add<T>(Vector<T> left, Vector<T> right) where T : struct => left + right;
+
+        public static Vector<T> Subtract<T>(Vector<T> left, Vector<T> right) where T : struct => left - right;
+
+        public static Vector<T> Multiply<T>(Vector<T> left, Vector<T> right) where T : struct => left * right;
+
+        public static Vector<T> Divide<T>(Vector<T> left, Vector<T> right) where T : struct => left / right;
+
+        public static Vector<T> Negate<T>(Vector<T> value) where T : struct => -value;
+
+        public static Vector<T> BitwiseAnd<T>(Vector<T> left, Vector<T> right) where T : struct => left & right;
+
+        public static Vector<T> BitwiseOr<T>(Vector<T> left, Vector<T> right) where T : struct => left | right;
+
+        public static Vector<T> Xor<T>(Vector<T> left, Vector<T> right) where T : struct => left ^ right;
+
+        public static Vector<T> OnesComplement<T>(Vector<T> value) where T : struct => ~value;
+
+        public static Vector<T> Equals<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.Equals((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> LessThan<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.LessThan((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> LessThanOrEqual<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.LessThanOrEqual((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> GreaterThan<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.GreaterThan((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> GreaterThanOrEqual<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.GreaterThanOrEqual((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> Min<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.Min((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> Max<T>(Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.Max((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<T> Abs<T>(Vector<T> value) where T : struct
+            => (Vector<T>)Vector128.Abs((Vector128<T>)value);
+
+        public static Vector<T> SquareRoot<T>(Vector<T> value) where T : struct
+            => (Vector<T>)Vector128.Sqrt((Vector128<T>)value);
+
+        public static Vector<T> ConditionalSelect<T>(Vector<T> condition, Vector<T> left, Vector<T> right) where T : struct
+            => (Vector<T>)Vector128.ConditionalSelect((Vector128<T>)condition, (Vector128<T>)left, (Vector128<T>)right);
+
+        public static T Dot<T>(Vector<T> left, Vector<T> right) where T : struct
+            => Vector128.Dot((Vector128<T>)left, (Vector128<T>)right);
+
+        public static Vector<TTo> As<TFrom, TTo>(this Vector<TFrom> vector) where TFrom : struct where TTo : struct
+            => (Vector<TTo>)((Vector128<TFrom>)vector).As<TFrom, TTo>();
+    }
+}
@@ -0,0 +1,144 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+
+namespace System.Numerics
+{
+    /// <summary>
+    /// A structure that represents a single Vector of a primitive numeric type.
+    /// Vectors are 128 bits wide on every target, so layouts match between the emulator and the boards.
+    /// </summary>
+    public readonly struct Vector<T> : IEquatable<Vector<T>> where T : struct
+    {
+        private readonly Vector128<T> _value;
+
+        private Vector(Vector128<T> value)
+        {
+            _value = value;
+        }
+
+        /// <summary>Constructs a vector whose components are all <paramref name="value" />.</summary>
+        public Vector(T value)
+        {
+            _value = Vector128.Create(value);
+        }
+
+        /// <summary>Constructs a vector from the given array, starting from the given index.</summary>
+        public Vector(T[] values, int index)
+        {
+            if (values == null)
+                ThrowHelper.ThrowArgumentNullException(ExceptionArgument.values);
+            if ((uint)index > (uint)values.Length || values.Length - index < Count)
+                ThrowHelper.ThrowArgumentOutOfRangeException(ExceptionArgument.index);
+            _value = Vector128.LoadUnsafe(ref values[index]);
+        }
+
+        /// <summary>Constructs a vector from the given span.</summary>
+        public Vector(ReadOnlySpan<T> values)
+        {
+            _value = Vector128.Create(values);
+        }
+
+        /// <summary>Returns the number of elements stored in the vector.</summary>
+        public static int Count => Vector128<T>.Count;
+
+        /// <summary>Returns a vector containing all zeroes.</summary>
+        public static Vector<T> Zero => default;
+
+        /// <summary>Returns a vector containing all ones.</summary>
+        public static Vector<T> One => new Vector<T>(GetOneValue());
+
+        /// <summary>Returns the element at the given index.</summary>
+        public T this[int index] => _value[index];
+
+        /// <summary>Copies the vector to the given span.</summary>
+        public void CopyTo(Span<T> destination)
+        {
+            _value.CopyTo(destination);
+        }
+
+        /// <summary>Copies the vector to the given array, starting from the given index.</summary>
+        public void CopyTo(T[] destination, int startIndex)
+        {
+            if (destination == null)
+                throw new ArgumentNullException(nameof(destination));
+            if ((uint)startIndex > (uint)destination.Length)
+                ThrowHelper.ThrowArgumentOutOfRangeException(ExceptionArgument.startIndex);
+            _value.CopyTo(new Span<T>(destination, startIndex, destination.Length - startIndex));
+        }
+
+        public static Vector<T> operator +(Vector<T> left, Vector<T> right) => new Vector<T>(left._value + right._value);
+
+        public static Vector<T> operator -(Vector<T> left, Vector<T> right) => new Vector<T>(left._value - right._value);
+
+        public static Vector<T> operator *(Vector<T> left, Vector<T> right) => new Vector<T>(left._value * right._value);
+
+        public static Vector<T> operator *(Vector<T> value, T factor) => new Vector<T>(value._value * Vector128.Create(factor));
+
+        public static Vector<T> operator *(T factor, Vector<T> value) => new Vector<T>(Vector128.Create(factor) * value._value);
+
+        public static Vector<T> operator /(Vector<T> left, Vector<T> right) => new Vector<T>(left._value / right._value);
+
+        public static Vector<T> operator -(Vector<T> value) => new Vector<T>(-value._value);
+
+        public static Vector<T> operator &(Vector<T> left, Vector<T> right) => new Vector<T>(left._value & right._value);
+
+        public static Vector<T> operator |(Vector<T> left, Vector<T> right) => new Vector<T>(left._value | right._value);
+
+        public static Vector<T> operator ^(Vector<T> left, Vector<T> right) => new Vector<T>(left._value ^ right._value);
+
+        public static Vector<T> operator ~(Vector<T> value) => new Vector<T>(~value._value);
+
+        public static bool operator ==(Vector<T> left, Vector<T> right) => left._value == right._value;
+
+        public static bool operator !=(Vector<T> left, Vector<T> right) => left._value != right._value;
+
+        public static explicit operator Vector128<T>(Vector<T> value) => value._value;
+
+        public static explicit operator Vector<T>(Vector128<T> value) => new Vector<T>(value);
+
+        public bool Equals(Vector<T> other)
+        {
+            return _value == other._value;
+        }
+
+        public override bool Equals(object? obj)
+        {
+            return (obj is Vector<T> other) && Equals(other);
+        }
+
+        public override int GetHashCode()
+        {
+            return _value.GetHashCode();
+        }
+
+        private static T GetOneValue()
+        {
+            if (typeof(T) == typeof(byte))
+                return (T)(object)(byte)1;
+            else if (typeof(T) == typeof(sbyte))
+                return (T)(object)(sbyte)1;
+            else if (typeof(T) == typeof(ushort))
+                return (T)(object)(ushort)1;
+            else if (typeof(T) == typeof(short))
+                return (T)(object)(short)1;
+            else if (typeof(T) == typeof(uint))
+                return (T)(object)1u;
+            else if (typeof(T) == typeof(int))
+                return (T)(object)1;
+            else if (typeof(T) == typeof(ulong))
+                return (T)(object)1ul;
+            else if (typeof(T) == typeof(long))
+                return (T)(object)1L;
+            else if (typeof(T) == typeof(float))
+                return (T)(object)1f;
+            else if (typeof(T) == typeof(double))
+                return (T)(object)1d;
+            else
+                throw new NotSupportedException(SR.Arg_TypeNotSupported);
+        }
+    }
+}
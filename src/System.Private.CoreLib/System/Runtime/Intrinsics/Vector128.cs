@@ -0,0 +1,146 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Internal.Runtime.CompilerServices;
+
+namespace System.Runtime.Intrinsics
+{
+    public static class Vector128
+    {
+        /// <summary>Gets a value that indicates whether 128-bit vector operations are subject to hardware acceleration.</summary>
+        /// <remarks>This is a compile-time constant of the generated code.</remarks>
+        public static extern bool IsHardwareAccelerated
+        {
+            [MethodImpl(MethodImplOptions.InternalCall)]
+            get;
+        }
+
+        /// <summary>Creates a new <see cref="Vector128{T}" /> instance with all elements initialized to the specified value.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Create<T>(T value) where T : struct;
+
+        /// <summary>Creates a new <see cref="Vector128{T}" /> from the first elements of a span.</summary>
+        public static Vector128<T> Create<T>(ReadOnlySpan<T> values) where T : struct
+        {
+            if (values.Length < Vector128<T>.Count)
+                ThrowHelper.ThrowArgumentOutOfRangeException(ExceptionArgument.values);
+            return LoadUnsafe(ref MemoryMarshal.GetReference(values));
+        }
+
+        /// <summary>Loads a vector from the given source, no alignment is required.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> LoadUnsafe<T>(ref T source) where T : struct;
+
+        /// <summary>Stores a vector at the given destination, no alignment is required.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern void StoreUnsafe<T>(this Vector128<T> source, ref T destination) where T : struct;
+
+        /// <summary>Copies a vector to the first elements of a span.</summary>
+        public static void CopyTo<T>(this Vector128<T> vector, Span<T> destination) where T : struct
+        {
+            if (destination.Length < Vector128<T>.Count)
+                ThrowHelper.ThrowArgumentException_DestinationTooShort();
+            StoreUnsafe(vector, ref MemoryMarshal.GetReference(destination));
+        }
+
+        public static T GetElement<T>(this Vector128<T> vector, int index) where T : struct => vector[index];
+
+        public static Vector128<T> Add<T>(Vector128<T> left, Vector128<T> right) where T : struct => left + right;
+
+        public static Vector128<T> Subtract<T>(Vector128<T> left, Vector128<T> right) where T : struct => left - right;
+
+        public static Vector128<T> Multiply<T>(Vector128<T> left, Vector128<T> right) where T : struct => left * right;
+
+        public static Vector128<T> Divide<T>(Vector128<T> left, Vector128<T> right) where T : struct => left / right;
+
+        public static Vector128<T> Negate<T>(Vector128<T> vector) where T : struct => -vector;
+
+        public static Vector128<T> BitwiseAnd<T>(Vector128<T> left, Vector128<T> right) where T : struct => left & right;
+
+        public static Vector128<T> BitwiseOr<T>(Vector128<T> left, Vector128<T> right) where T : struct => left | right;
+
+        public static Vector128<T> Xor<T>(Vector128<T> left, Vector128<T> right) where T : struct => left ^ right;
+
+        public static Vector128<T> OnesComplement<T>(Vector128<T> vector) where T : struct => ~vector;
+
+        /// <summary>Compares two vectors per element, equal elements have all bits set in the result.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Equals<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> LessThan<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> LessThanOrEqual<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> GreaterThan<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> GreaterThanOrEqual<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Min<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Max<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Abs<T>(Vector128<T> vector) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> Sqrt<T>(Vector128<T> vector) where T : struct;
+
+        /// <summary>Selects bits from left where the condition bit is set and from right otherwise.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> ConditionalSelect<T>(Vector128<T> condition, Vector128<T> left, Vector128<T> right) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern T Sum<T>(Vector128<T> vector) where T : struct;
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern T Dot<T>(Vector128<T> left, Vector128<T> right) where T : struct;
+
+        // Shuffle picks the element of vector at each index, indices out of range give zero
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<byte> Shuffle(Vector128<byte> vector, Vector128<byte> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<sbyte> Shuffle(Vector128<sbyte> vector, Vector128<sbyte> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<short> Shuffle(Vector128<short> vector, Vector128<short> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<ushort> Shuffle(Vector128<ushort> vector, Vector128<ushort> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<int> Shuffle(Vector128<int> vector, Vector128<int> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<uint> Shuffle(Vector128<uint> vector, Vector128<uint> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<float> Shuffle(Vector128<float> vector, Vector128<int> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<long> Shuffle(Vector128<long> vector, Vector128<long> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<ulong> Shuffle(Vector128<ulong> vector, Vector128<ulong> indices);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<double> Shuffle(Vector128<double> vector, Vector128<long> indices);
+
+        /// <summary>Reinterprets the bits of a vector as a vector of another element type.</summary>
+        public static Vector128<TTo> As<TFrom, TTo>(this Vector128<TFrom> vector) where TFrom : struct where TTo : struct
+        {
+            return Unsafe.As<Vector128<TFrom>, Vector128<TTo>>(ref vector);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Internal.Runtime.CompilerServices;
+
+namespace System.Runtime.Intrinsics
+{
+    // The operators are lowered by Natsu.Compiler to natsu::simd, which uses the vector extensions of the C++ compiler
+    [StructLayout(LayoutKind.Sequential, Size = 16)]
+    public readonly struct Vector128<T> : IEquatable<Vector128<T>> where T : struct
+    {
+        // These fields exist to ensure alignment is 8, rather than 1.
+        // This also allows the debug view to work https://github.com/dotnet/coreclr/issues/15694)
+        private readonly ulong _00;
+        private readonly ulong _01;
+
+        /// <summary>Gets the number of <typeparamref name="T" /> that are in a <see cref="Vector128{T}" />.</summary>
+        public static int Count => 16 / Unsafe.SizeOf<T>();
+
+        /// <summary>Gets a new <see cref="Vector128{T}" /> with all elements initialized to zero.</summary>
+        public static Vector128<T> Zero => default;
+
+        /// <summary>Gets a new <see cref="Vector128{T}" /> with all bits set to 1.</summary>
+        public static extern Vector128<T> AllBitsSet
+        {
+            [MethodImpl(MethodImplOptions.InternalCall)]
+            get;
+        }
+
+        /// <summary>Gets the element at the specified index.</summary>
+        public T this[int index]
+        {
+            get
+            {
+                if ((uint)index >= (uint)Count)
+                    ThrowHelper.ThrowArgumentOutOfRangeException(ExceptionArgument.index);
+                return Unsafe.Add(ref Unsafe.As<Vector128<T>, T>(ref Unsafe.AsRef(in this)), index);
+            }
+        }
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator +(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator -(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator *(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator /(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator -(Vector128<T> value);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator &(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator |(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator ^(Vector128<T> left, Vector128<T> right);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern Vector128<T> operator ~(Vector128<T> value);
+
+        /// <summary>Compares two vectors to determine if all elements are equal.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern bool operator ==(Vector128<T> left, Vector128<T> right);
+
+        /// <summary>Compares two vectors to determine if any elements are not equal.</summary>
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        public static extern bool operator !=(Vector128<T> left, Vector128<T> right);
+
+        public bool Equals(Vector128<T> other)
+        {
+            return this == other;
+        }
+
+        public override bool Equals(object? obj)
+        {
+            return (obj is Vector128<T> other) && Equals(other);
+        }
+
+        public override int GetHashCode()
+        {
+            HashCode hashCode = default;
+            for (int i = 0; i < Count; i++)
+                hashCode.Add(this[i]);
+            return hashCode.ToHashCode();
+        }
+    }
+}
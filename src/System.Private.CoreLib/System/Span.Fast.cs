@@ -162,14 +162,17 @@ namespace System
         [MethodImpl(MethodImplOptions.AggressiveInlining)]
         public void Clear()
         {
-            //if (RuntimeHelpers.IsReferenceOrContainsReferences<T>())
-            //{
-            //    SpanHelpers.ClearWithReferences(ref Unsafe.As<T, IntPtr>(ref _pointer.Value), (nuint)_length * (nuint)(Unsafe.SizeOf<T>() / sizeof(nuint)));
-            //}
-            //else
-            //{
-            //    SpanHelpers.ClearWithoutReferences(ref Unsafe.As<T, byte>(ref _pointer.Value), (nuint)_length * (nuint)Unsafe.SizeOf<T>());
-            //}
+            if (RuntimeHelpers.IsReferenceOrContainsReferences<T>())
+            {
+                // Cleared one element at a time, so the collector sees every reference being dropped
+                ref T start = ref _pointer.Value;
+                for (int i = 0; i < _length; i++)
+                    Unsafe.Add(ref start, i) = default;
+            }
+            else
+            {
+                SpanHelpers.ClearWithoutReferences(ref Unsafe.As<T, byte>(ref _pointer.Value), (nuint)_length * (nuint)Unsafe.SizeOf<T>());
+            }
         }
 
         /// <summary>
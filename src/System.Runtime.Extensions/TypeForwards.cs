@@ -3,3 +3,4 @@ using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 
 [assembly: TypeForwardedTo(typeof(Math))]
+[assembly: TypeForwardedTo(typeof(MathF))]
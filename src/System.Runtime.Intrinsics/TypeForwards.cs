@@ -0,0 +1,6 @@
+﻿using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.Intrinsics;
+
+[assembly: TypeForwardedTo(typeof(Vector128))]
+[assembly: TypeForwardedTo(typeof(Vector128<>))]
@@ -12,6 +12,9 @@ namespace Chino.Apps.Shell
         public CommandInterpreter()
         {
             RegisterCommand("free", new FreeCommand());
+            RegisterCommand("heap", new HeapCommand());
+            RegisterCommand("allocprof", new AllocProfCommand());
+            RegisterCommand("profile", new ProfileCommand());
             RegisterCommand("echo", new EchoCommand());
         }
 
@@ -0,0 +1,37 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using Chino.Memory;
+
+namespace Chino.Apps.Shell.Commands
+{
+    class AllocProfCommand : ShellCommand
+    {
+        private const int DefaultInterval = 4096;
+
+        public override void Execute(string[] args)
+        {
+            var action = args.Length > 1 ? args[1] : "dump";
+            switch (action)
+            {
+                case "start":
+                    var interval = args.Length > 2 ? int.Parse(args[2]) : DefaultInterval;
+                    MemoryManager.SetAllocationSampleInterval(interval);
+                    Console.WriteLine($"Sampling every {interval} bytes");
+                    break;
+                case "stop":
+                    MemoryManager.SetAllocationSampleInterval(0);
+                    break;
+                case "dump":
+                    // Natsu.AllocSymbolizer reads the lines after the header
+                    Console.WriteLine($"# natsu allocation samples, interval {MemoryManager.GetAllocationSampleInterval()}");
+                    for (int i = 0; MemoryManager.GetAllocationSample(i, out var callSite, out var type, out var size); i++)
+                        Console.WriteLine($"{callSite.ToInt64():X} {type.ToInt64():X} {size}");
+                    break;
+                default:
+                    Console.WriteLine("usage: allocprof [start [bytes] | stop | dump]");
+                    break;
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using Chino.Memory;
+
+namespace Chino.Apps.Shell.Commands
+{
+    class HeapCommand : ShellCommand
+    {
+        public override void Execute(string[] args)
+        {
+            var usedMemory = MemoryManager.GetUsedMemorySize() / 1024f;
+            var freeMemory = MemoryManager.GetFreeMemorySize() / 1024f;
+            var peakMemory = usedMemory + freeMemory - MemoryManager.GetMinimumEverFreeMemorySize() / 1024f;
+            Console.WriteLine($"Heap\t\t  Used\t {usedMemory:F2} K");
+            Console.WriteLine($"\t\t  Peak\t {peakMemory:F2} K");
+            Console.WriteLine($"\t\t  Free\t {freeMemory:F2} K");
+            Console.WriteLine($"\t\t Largest\t {MemoryManager.GetLargestFreeBlockSize() / 1024f:F2} K");
+            Console.WriteLine($"\t\t  Frag\t {MemoryManager.GetFragmentation() * 100:F1} %");
+            Console.WriteLine();
+            Console.WriteLine("Count\t\t Bytes\t\t VTable");
+            for (int i = 0; MemoryManager.GetAllocationStatistics(i, out var type, out var count, out var bytes); i++)
+                Console.WriteLine($"{count}\t\t {bytes}\t\t {type.ToInt64():X}");
+        }
+    }
+}
@@ -0,0 +1,16 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using Chino.Diagnostics;
+
+namespace Chino.Apps.Shell.Commands
+{
+    class ProfileCommand : ShellCommand
+    {
+        public override void Execute(string[] args)
+        {
+            if (!CodeProfile.Dump())
+                Console.WriteLine("profile: the kernel is built without CHINO_PROFILE");
+        }
+    }
+}
@@ -0,0 +1,69 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class BitwiseEquatableTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private ITypeDefOrRef CorLibType(string name)
+        {
+            return new TypeRefUser(_module.Module, "System", name, _module.CorLibTypes.AssemblyRef);
+        }
+
+        // struct Pair { int A; int B; static int Count; }
+        private TypeDef AddPair()
+        {
+            var type = _module.AddType("Pair", CorLibType("ValueType"), TypeAttributes.Public | TypeAttributes.Sealed);
+            type.Fields.Add(new FieldDefUser("A", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public));
+            type.Fields.Add(new FieldDefUser("B", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public));
+            type.Fields.Add(new FieldDefUser("Count", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public | FieldAttributes.Static));
+            return type;
+        }
+
+        [Fact]
+        public void TestClassIsNotBitwiseEquatable()
+        {
+            var type = _module.AddType("Box", _module.CorLibTypes.Object.TypeDefOrRef);
+            Assert.Equal("false", Generator.GetIsBitwiseEquatable(type, "Box"));
+        }
+
+        [Fact]
+        public void TestEnumIsBitwiseEquatable()
+        {
+            var type = _module.AddType("Color", CorLibType("Enum"), TypeAttributes.Public | TypeAttributes.Sealed);
+            type.Fields.Add(new FieldDefUser("value__", new FieldSig(_module.CorLibTypes.Int32),
+                FieldAttributes.Public | FieldAttributes.SpecialName | FieldAttributes.RTSpecialName));
+            Assert.Equal("true", Generator.GetIsBitwiseEquatable(type, "Color"));
+        }
+
+        [Fact]
+        public void TestStructComparesItsInstanceFields()
+        {
+            var type = AddPair();
+            Assert.Equal("std::has_unique_object_representations_v<Pair>"
+                + " && ::natsu::is_bitwise_equatable_v<decltype(Pair::A)>"
+                + " && ::natsu::is_bitwise_equatable_v<decltype(Pair::B)>",
+                Generator.GetIsBitwiseEquatable(type, "Pair"));
+        }
+
+        [Fact]
+        public void TestStructWithOwnEqualsIsNotBitwiseEquatable()
+        {
+            var type = AddPair();
+            _module.AddMethod(type, new MethodDefUser("Equals", MethodSig.CreateInstance(_module.CorLibTypes.Boolean, _module.CorLibTypes.Object),
+                MethodAttributes.Public | MethodAttributes.Virtual | MethodAttributes.HideBySig));
+            Assert.Equal("false", Generator.GetIsBitwiseEquatable(type, "Pair"));
+        }
+    }
+}
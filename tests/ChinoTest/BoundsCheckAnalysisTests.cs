@@ -0,0 +1,84 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class BoundsCheckAnalysisTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly TypeDef _type;
+
+        public BoundsCheckAnalysisTests()
+        {
+            _type = _module.AddType("Test", _module.CorLibTypes.Object.TypeDefOrRef);
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        // int Sum(int[] a) { int s = 0; for (int i = start; i cmp a.Length; i++) s += a[i]; return s; }
+        private (MethodDef method, Instruction access) AddSum(int start, OpCode compare)
+        {
+            var array = new SZArraySig(_module.CorLibTypes.Int32);
+            var i = new Local(_module.CorLibTypes.Int32);
+            var s = new Local(_module.CorLibTypes.Int32);
+            var access = Instruction.Create(OpCodes.Ldelem_I4);
+            var loop = Instruction.Create(OpCodes.Ldloc, s);
+            var condition = Instruction.Create(OpCodes.Ldloc, i);
+            var method = _module.AddMethod(_type, new MethodDefUser("Sum", MethodSig.CreateStatic(_module.CorLibTypes.Int32, array)),
+                Instruction.Create(OpCodes.Ldc_I4, start),
+                Instruction.Create(OpCodes.Stloc, i),
+                Instruction.Create(OpCodes.Ldc_I4_0),
+                Instruction.Create(OpCodes.Stloc, s),
+                Instruction.Create(OpCodes.Br, condition),
+                loop,
+                Instruction.Create(OpCodes.Ldarg_0),
+                Instruction.Create(OpCodes.Ldloc, i),
+                access,
+                Instruction.Create(OpCodes.Add),
+                Instruction.Create(OpCodes.Stloc, s),
+                Instruction.Create(OpCodes.Ldloc, i),
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                Instruction.Create(OpCodes.Add),
+                Instruction.Create(OpCodes.Stloc, i),
+                condition,
+                Instruction.Create(OpCodes.Ldarg_0),
+                Instruction.Create(OpCodes.Ldlen),
+                Instruction.Create(OpCodes.Conv_I4),
+                Instruction.Create(compare, loop),
+                Instruction.Create(OpCodes.Ldloc, s),
+                Instruction.Create(OpCodes.Ret));
+            method.Body.Variables.Add(i);
+            method.Body.Variables.Add(s);
+            return (method, access);
+        }
+
+        [Fact]
+        public void TestLoopBelowLengthIsUnchecked()
+        {
+            var (method, access) = AddSum(0, OpCodes.Blt);
+            Assert.Contains(access, BoundsCheckAnalysis.FindUncheckedAccesses(method));
+        }
+
+        [Fact]
+        public void TestLoopUpToLengthIsChecked()
+        {
+            var (method, access) = AddSum(0, OpCodes.Ble);
+            Assert.DoesNotContain(access, BoundsCheckAnalysis.FindUncheckedAccesses(method));
+        }
+
+        [Fact]
+        public void TestNegativeStartIsChecked()
+        {
+            var (method, access) = AddSum(-1, OpCodes.Blt);
+            Assert.DoesNotContain(access, BoundsCheckAnalysis.FindUncheckedAccesses(method));
+        }
+    }
+}
@@ -0,0 +1,71 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    [Collection("Compiler")]
+    public class ClassHierarchyTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private MethodDef AddVirtual(TypeDef type, string name, MethodAttributes attributes)
+        {
+            return _module.AddMethod(type, new MethodDefUser(name, MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Virtual | MethodAttributes.HideBySig | attributes));
+        }
+
+        [Fact]
+        public void TestSingleOverrideIsDevirtualized()
+        {
+            var baseType = _module.AddType("Base", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Abstract);
+            var baseRun = AddVirtual(baseType, "Run", MethodAttributes.NewSlot | MethodAttributes.Abstract);
+            var derived = _module.AddType("Derived", baseType);
+            var derivedRun = AddVirtual(derived, "Run", MethodAttributes.ReuseSlot);
+            ClassHierarchy.AddModule(_module.Module);
+
+            Assert.Same(derivedRun, ClassHierarchy.FindSingleTarget(baseRun));
+        }
+
+        [Fact]
+        public void TestTwoOverridesStayVirtual()
+        {
+            var baseType = _module.AddType("Base", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Abstract);
+            var baseRun = AddVirtual(baseType, "Run", MethodAttributes.NewSlot | MethodAttributes.Abstract);
+            AddVirtual(_module.AddType("Left", baseType), "Run", MethodAttributes.ReuseSlot);
+            AddVirtual(_module.AddType("Right", baseType), "Run", MethodAttributes.ReuseSlot);
+            ClassHierarchy.AddModule(_module.Module);
+
+            Assert.Null(ClassHierarchy.FindSingleTarget(baseRun));
+        }
+
+        [Fact]
+        public void TestSealedTypeIsDevirtualized()
+        {
+            var type = _module.AddType("Leaf", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Sealed);
+            var run = AddVirtual(type, "Run", MethodAttributes.NewSlot);
+            ClassHierarchy.AddModule(_module.Module);
+
+            Assert.Same(run, ClassHierarchy.FindSingleTarget(run));
+        }
+
+        [Fact]
+        public void TestInterfaceStaysVirtual()
+        {
+            var type = _module.AddType("IRunnable", null, TypeAttributes.Public | TypeAttributes.Interface | TypeAttributes.Abstract);
+            var run = AddVirtual(type, "Run", MethodAttributes.NewSlot | MethodAttributes.Abstract);
+            AddVirtual(_module.AddType("Runner", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Sealed), "Run", MethodAttributes.NewSlot | MethodAttributes.Final);
+            ClassHierarchy.AddModule(_module.Module);
+
+            Assert.Null(ClassHierarchy.FindSingleTarget(run));
+        }
+    }
+}
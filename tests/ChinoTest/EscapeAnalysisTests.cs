@@ -0,0 +1,99 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class EscapeAnalysisTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly TypeDef _point;
+        private readonly MethodDef _ctor;
+        private readonly FieldDef _x;
+        private readonly TypeDef _program;
+
+        // class Point { public int X; public Point(int x) { X = x; } }
+        public EscapeAnalysisTests()
+        {
+            _point = _module.AddType("Point", _module.CorLibTypes.Object.TypeDefOrRef);
+            _x = new FieldDefUser("X", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public);
+            _point.Fields.Add(_x);
+            _ctor = _module.AddMethod(_point, new MethodDefUser(".ctor", MethodSig.CreateInstance(_module.CorLibTypes.Void, _module.CorLibTypes.Int32),
+                MethodAttributes.Public | MethodAttributes.HideBySig | MethodAttributes.SpecialName | MethodAttributes.RTSpecialName),
+                Instruction.Create(OpCodes.Ldarg_0),
+                Instruction.Create(OpCodes.Ldarg_1),
+                Instruction.Create(OpCodes.Stfld, _x),
+                Instruction.Create(OpCodes.Ret));
+            _program = _module.AddType("Program", _module.CorLibTypes.Object.TypeDefOrRef);
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private MethodDef AddStatic(string name, TypeSig returnType, params Instruction[] instructions)
+        {
+            return _module.AddMethod(_program, new MethodDefUser(name, MethodSig.CreateStatic(returnType),
+                MethodAttributes.Public | MethodAttributes.Static), instructions);
+        }
+
+        [Fact]
+        public void TestLocalObjectIsStackAllocated()
+        {
+            var site = Instruction.Create(OpCodes.Newobj, _ctor);
+            var method = AddStatic("GetX", _module.CorLibTypes.Int32,
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                site,
+                Instruction.Create(OpCodes.Ldfld, _x),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Contains(site, EscapeAnalysis.FindStackAllocations(method));
+        }
+
+        [Fact]
+        public void TestReturnedObjectEscapes()
+        {
+            var site = Instruction.Create(OpCodes.Newobj, _ctor);
+            var method = AddStatic("Make", new ClassSig(_point),
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                site,
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.DoesNotContain(site, EscapeAnalysis.FindStackAllocations(method));
+        }
+
+        [Fact]
+        public void TestObjectStoredToStaticEscapes()
+        {
+            var last = new FieldDefUser("Last", new FieldSig(new ClassSig(_point)), FieldAttributes.Public | FieldAttributes.Static);
+            _program.Fields.Add(last);
+            var site = Instruction.Create(OpCodes.Newobj, _ctor);
+            var method = AddStatic("Keep", _module.CorLibTypes.Void,
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                site,
+                Instruction.Create(OpCodes.Stsfld, last),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.DoesNotContain(site, EscapeAnalysis.FindStackAllocations(method));
+        }
+
+        [Fact]
+        public void TestObjectAllocatedInLoopIsNotStackAllocated()
+        {
+            var loop = Instruction.Create(OpCodes.Ldc_I4_1);
+            var site = Instruction.Create(OpCodes.Newobj, _ctor);
+            var method = AddStatic("Spin", _module.CorLibTypes.Void,
+                loop,
+                site,
+                Instruction.Create(OpCodes.Pop),
+                Instruction.Create(OpCodes.Br, loop));
+
+            Assert.DoesNotContain(site, EscapeAnalysis.FindStackAllocations(method));
+        }
+    }
+}
@@ -0,0 +1,59 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class FloatArithmeticTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly OpEmitter _emitter = new OpEmitter { Stack = new EvaluationStack(new StringWriter(), 0, 0, new RootPool()) };
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private StackEntry EmitBinary(Action<OpEmitter> emit, TypeSig left, TypeSig right)
+        {
+            _emitter.Stack.Push(left, "a");
+            _emitter.Stack.Push(right, "b");
+            emit(_emitter);
+            return _emitter.Stack.Pop();
+        }
+
+        [Fact]
+        public void TestSingleArithmeticStaysSingle()
+        {
+            var result = EmitBinary(x => x.Mul(), _module.CorLibTypes.Single, _module.CorLibTypes.Single);
+            Assert.Equal(ElementType.R4, result.Type.TypeSig.ElementType);
+            Assert.Equal("(a * b)", result.Expression);
+        }
+
+        [Fact]
+        public void TestDoubleOperandWidensResult()
+        {
+            var result = EmitBinary(x => x.Add(), _module.CorLibTypes.Single, _module.CorLibTypes.Double);
+            Assert.Equal(ElementType.R8, result.Type.TypeSig.ElementType);
+        }
+
+        [Fact]
+        public void TestSingleRemainderUsesFmodf()
+        {
+            var result = EmitBinary(x => x.Rem(), _module.CorLibTypes.Single, _module.CorLibTypes.Single);
+            Assert.Equal("fmodf(a, b)", result.Expression);
+        }
+
+        [Fact]
+        public void TestMixedRemainderUsesFmod()
+        {
+            var result = EmitBinary(x => x.Rem(), _module.CorLibTypes.Single, _module.CorLibTypes.Double);
+            Assert.Equal(ElementType.R8, result.Type.TypeSig.ElementType);
+            Assert.Equal("fmod(a, b)", result.Expression);
+        }
+    }
+}
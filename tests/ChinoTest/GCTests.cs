@@ -0,0 +1,137 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    // The collector relies on the compiler to root every temporary that may hold a reference and to route every
+    // reference store through gc_barrier, these pin down the code the compiler hands to the collector
+    public class GCTests
+    {
+        private readonly ModuleDef _module = new ModuleDefUser("Test");
+        private readonly TypeDef _type;
+        private readonly FieldDef _next;
+        private readonly FieldDef _value;
+
+        public GCTests()
+        {
+            _type = new TypeDefUser("Chino", "Node", _module.CorLibTypes.Object.TypeDefOrRef);
+            _next = new FieldDefUser("Next", new FieldSig(_module.CorLibTypes.Object), FieldAttributes.Public);
+            _value = new FieldDefUser("Value", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public);
+            _type.Fields.Add(_next);
+            _type.Fields.Add(_value);
+            _module.Types.Add(_type);
+        }
+
+        private OpEmitter CreateEmitter(TextWriter writer, List<StackEntry> roots, Instruction op)
+        {
+            return new OpEmitter
+            {
+                CorLibTypes = _module.CorLibTypes,
+                Op = op,
+                Stack = new EvaluationStack(writer, 0, 0, roots),
+                Writer = writer
+            };
+        }
+
+        private static StackType MakeStackType(StackTypeCode code, TypeSig type, string name)
+        {
+            return new StackType { Code = code, TypeSig = type, Name = name };
+        }
+
+        [Fact]
+        public void TestByRefMayContainGCRefs()
+        {
+            // An interior pointer into the heap keeps its object alive
+            Assert.True(TypeUtils.MayContainGCRefs(new ByRefSig(_module.CorLibTypes.Int32)));
+            Assert.True(TypeUtils.MayContainGCRefs(MakeStackType(StackTypeCode.Ref, new ByRefSig(_module.CorLibTypes.Int32), "int32_t")));
+            Assert.False(TypeUtils.MayContainGCRefs(new PtrSig(_module.CorLibTypes.Int32)));
+            Assert.False(TypeUtils.MayContainGCRefs(_module.CorLibTypes.Int32));
+        }
+
+        [Fact]
+        public void TestByRefTemporaryIsRooted()
+        {
+            var writer = new StringWriter();
+            var roots = new List<StackEntry>();
+            var stack = new EvaluationStack(writer, 0, 0, roots);
+            stack.Push(MakeStackType(StackTypeCode.Ref, new ByRefSig(_module.CorLibTypes.Int32), "int32_t"), "::natsu::ops::ref(node->Value)");
+            stack.Root();
+
+            Assert.Single(roots);
+            Assert.True(roots[0].Computed);
+            Assert.Equal(roots[0].Expression, stack.Peek().Expression);
+            Assert.Contains($"{roots[0].Expression} = ::natsu::ops::ref(node->Value);", writer.ToString());
+        }
+
+        [Fact]
+        public void TestSpanTemporaryIsRooted()
+        {
+            // A span is a value type holding a byref, so it is rooted like one
+            var span = new ValueTypeSig(new TypeRefUser(_module, "System", "Span`1", _module.CorLibTypes.AssemblyRef));
+            var writer = new StringWriter();
+            var roots = new List<StackEntry>();
+            var stack = new EvaluationStack(writer, 0, 0, roots);
+            stack.Push(MakeStackType(StackTypeCode.ValueType, span, "Span"), "make_span()");
+            stack.Root();
+
+            Assert.Single(roots);
+        }
+
+        [Fact]
+        public void TestPrimitiveTemporaryIsNotRooted()
+        {
+            var writer = new StringWriter();
+            var roots = new List<StackEntry>();
+            var stack = new EvaluationStack(writer, 0, 0, roots);
+            stack.Push(MakeStackType(StackTypeCode.Int32, _module.CorLibTypes.Int32, "int32_t"), "42");
+            stack.Root();
+
+            Assert.Empty(roots);
+            Assert.Equal(string.Empty, writer.ToString());
+        }
+
+        [Fact]
+        public void TestReferenceFieldStoreHasBarrier()
+        {
+            // Storing a young object into an old one must mark the card of the slot
+            var writer = new StringWriter();
+            var emitter = CreateEmitter(writer, new List<StackEntry>(), Instruction.Create(OpCodes.Stfld, _next));
+            emitter.Stack.Push(MakeStackType(StackTypeCode.O, _type.ToTypeSig(), "Node"), "old");
+            emitter.Stack.Push(MakeStackType(StackTypeCode.O, _module.CorLibTypes.Object, "Object"), "young");
+            emitter.Stfld();
+
+            Assert.Equal("::natsu::gc_barrier(old->Next) = young;", writer.ToString().Trim());
+        }
+
+        [Fact]
+        public void TestPrimitiveFieldStoreHasNoBarrier()
+        {
+            var writer = new StringWriter();
+            var emitter = CreateEmitter(writer, new List<StackEntry>(), Instruction.Create(OpCodes.Stfld, _value));
+            emitter.Stack.Push(MakeStackType(StackTypeCode.O, _type.ToTypeSig(), "Node"), "old");
+            emitter.Stack.Push(MakeStackType(StackTypeCode.Int32, _module.CorLibTypes.Int32, "int32_t"), "42");
+            emitter.Stfld();
+
+            Assert.Equal("old->Value = 42;", writer.ToString().Trim());
+        }
+
+        [Fact]
+        public void TestIndirectReferenceStoreHasBarrier()
+        {
+            // The slot may be a field of an old object reached through a byref
+            var writer = new StringWriter();
+            var emitter = CreateEmitter(writer, new List<StackEntry>(), Instruction.Create(OpCodes.Stind_Ref));
+            emitter.Stack.Push(MakeStackType(StackTypeCode.Ref, new ByRefSig(_module.CorLibTypes.Object), "Object"), "slot");
+            emitter.Stack.Push(MakeStackType(StackTypeCode.O, _module.CorLibTypes.Object, "Object"), "young");
+            emitter.Stind_Ref();
+
+            Assert.Equal("::natsu::gc_barrier(*slot) = young;", writer.ToString().Trim());
+        }
+    }
+}
@@ -0,0 +1,108 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class IntrinsicLoweringTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly StringWriter _writer = new StringWriter();
+        private readonly OpEmitter _emitter;
+
+        public IntrinsicLoweringTests()
+        {
+            _emitter = new OpEmitter { Stack = new EvaluationStack(_writer, 0, 0, new RootPool()) };
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private TypeRef CorLibType(string @namespace, string name)
+        {
+            return new TypeRefUser(_module.Module, @namespace, name, _module.CorLibTypes.AssemblyRef);
+        }
+
+        private MemberRef CorLibMethod(string @namespace, string typeName, string name, MethodSig signature)
+        {
+            return new MemberRefUser(_module.Module, name, signature, CorLibType(@namespace, typeName));
+        }
+
+        // Arguments carry the parameter's own signature, so they are passed through without a cast
+        private string EmitCall(IMethod member, params string[] args)
+        {
+            for (int i = 0; i < args.Length; i++)
+            {
+                var type = member.MethodSig.Params[i];
+                _emitter.Stack.Push(new StackEntry { Type = new StackType { Code = StackTypeCode.ValueType, TypeSig = type, Name = "arg" }, Expression = args[i] });
+            }
+
+            _emitter.Op = Instruction.Create(OpCodes.Call, member);
+            _emitter.Call();
+            return _emitter.Stack.Pop().Expression;
+        }
+
+        [Fact]
+        public void TestPopCountLowersToBuiltin()
+        {
+            var popCount = CorLibMethod("System.Numerics", "BitOperations", "PopCount",
+                MethodSig.CreateStatic(_module.CorLibTypes.Int32, _module.CorLibTypes.UInt32));
+            Assert.Equal("::natsu::ops::popcount(static_cast<uint32_t>(x))", EmitCall(popCount, "x"));
+        }
+
+        [Fact]
+        public void TestRotateOfUInt64IsSixtyFourBit()
+        {
+            var rotateLeft = CorLibMethod("System.Numerics", "BitOperations", "RotateLeft",
+                MethodSig.CreateStatic(_module.CorLibTypes.UInt64, _module.CorLibTypes.UInt64, _module.CorLibTypes.Int32));
+            Assert.Equal("::natsu::ops::rotl(static_cast<uint64_t>(x), n)", EmitCall(rotateLeft, "x", "n"));
+        }
+
+        [Fact]
+        public void TestUnsafeSizeOfIsConstant()
+        {
+            var sizeOf = new MethodSpecUser(
+                CorLibMethod("Internal.Runtime.CompilerServices", "Unsafe", "SizeOf", MethodSig.CreateStaticGeneric(1, _module.CorLibTypes.Int32)),
+                new GenericInstMethodSig(_module.CorLibTypes.Int64));
+            Assert.Equal("int32_t(sizeof(int64_t))", EmitCall(sizeOf));
+        }
+
+        [Fact]
+        public void TestVectorIsHardwareAcceleratedIsConstant()
+        {
+            var isHardwareAccelerated = CorLibMethod("System.Runtime.Intrinsics", "Vector128", "get_IsHardwareAccelerated",
+                MethodSig.CreateStatic(_module.CorLibTypes.Boolean));
+            Assert.Equal("::natsu::simd::is_hardware_accelerated", EmitCall(isHardwareAccelerated));
+        }
+
+        [Fact]
+        public void TestVectorSumLowersToSimd()
+        {
+            // static T Sum<T>(Vector128<T> vector)
+            var vector = new GenericInstSig(new ValueTypeSig(CorLibType("System.Runtime.Intrinsics", "Vector128`1")), new GenericMVar(0));
+            var sum = new MethodSpecUser(
+                CorLibMethod("System.Runtime.Intrinsics", "Vector128", "Sum", MethodSig.CreateStaticGeneric(1, new GenericMVar(0), vector)),
+                new GenericInstMethodSig(_module.CorLibTypes.Single));
+            Assert.Equal("::natsu::simd::sum<float>(v)", EmitCall(sum, "v"));
+        }
+
+        [Fact]
+        public void TestVectorOperatorLowersToSimd()
+        {
+            // Vector128<int>.op_Division(Vector128<T>, Vector128<T>), the vector result is rooted into a temporary
+            var generic = CorLibType("System.Runtime.Intrinsics", "Vector128`1");
+            var vector = new GenericInstSig(new ValueTypeSig(generic), new GenericVar(0));
+            var division = new MemberRefUser(_module.Module, "op_Division", MethodSig.CreateStatic(vector, vector, vector),
+                new TypeSpecUser(new GenericInstSig(new ValueTypeSig(generic), _module.CorLibTypes.Int32)));
+            EmitCall(division, "a", "b");
+            Assert.Contains("::natsu::simd::divide<int32_t>(a, b)", _writer.ToString());
+        }
+    }
+}
@@ -0,0 +1,114 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class NullCheckAnalysisTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly TypeDef _node;
+        private readonly MethodDef _run;
+        private readonly FieldDef _next;
+
+        // class Node { public Node Next; public void Run() { } }
+        public NullCheckAnalysisTests()
+        {
+            _node = _module.AddType("Node", _module.CorLibTypes.Object.TypeDefOrRef);
+            _next = new FieldDefUser("Next", new FieldSig(new ClassSig(_node)), FieldAttributes.Public);
+            _node.Fields.Add(_next);
+            _run = _module.AddMethod(_node, new MethodDefUser("Run", MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.HideBySig),
+                Instruction.Create(OpCodes.Ret));
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        // static void Use(Node node)
+        private MethodDef AddUse(params Instruction[] instructions)
+        {
+            return _module.AddMethod(_node, new MethodDefUser("Use", MethodSig.CreateStatic(_module.CorLibTypes.Void, new ClassSig(_node)),
+                MethodAttributes.Public | MethodAttributes.Static), instructions);
+        }
+
+        [Fact]
+        public void TestCallAfterNullBranchIsUnchecked()
+        {
+            var end = Instruction.Create(OpCodes.Ret);
+            var call = Instruction.Create(OpCodes.Callvirt, _run);
+            var method = AddUse(
+                Instruction.Create(OpCodes.Ldarg_0),
+                Instruction.Create(OpCodes.Brfalse, end),
+                Instruction.Create(OpCodes.Ldarg_0),
+                call,
+                end);
+
+            Assert.Contains(call, NullCheckAnalysis.FindRedundantNullChecks(method));
+        }
+
+        [Fact]
+        public void TestArgumentIsChecked()
+        {
+            var call = Instruction.Create(OpCodes.Callvirt, _run);
+            var method = AddUse(
+                Instruction.Create(OpCodes.Ldarg_0),
+                call,
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.DoesNotContain(call, NullCheckAnalysis.FindRedundantNullChecks(method));
+        }
+
+        [Fact]
+        public void TestSecondCallIsUnchecked()
+        {
+            var first = Instruction.Create(OpCodes.Callvirt, _run);
+            var second = Instruction.Create(OpCodes.Callvirt, _run);
+            var method = AddUse(
+                Instruction.Create(OpCodes.Ldarg_0),
+                first,
+                Instruction.Create(OpCodes.Ldarg_0),
+                second,
+                Instruction.Create(OpCodes.Ret));
+
+            var redundant = NullCheckAnalysis.FindRedundantNullChecks(method);
+            Assert.DoesNotContain(first, redundant);
+            Assert.Contains(second, redundant);
+        }
+
+        [Fact]
+        public void TestFieldLoadIsNotACheck()
+        {
+            // Without an MMU a load from a null reference doesn't fault, so it proves nothing
+            var call = Instruction.Create(OpCodes.Callvirt, _run);
+            var method = AddUse(
+                Instruction.Create(OpCodes.Ldarg_0),
+                Instruction.Create(OpCodes.Ldfld, _next),
+                Instruction.Create(OpCodes.Pop),
+                Instruction.Create(OpCodes.Ldarg_0),
+                call,
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.DoesNotContain(call, NullCheckAnalysis.FindRedundantNullChecks(method));
+        }
+
+        [Fact]
+        public void TestThisIsUnchecked()
+        {
+            var call = Instruction.Create(OpCodes.Callvirt, _run);
+            var method = _module.AddMethod(_node, new MethodDefUser("RunTwice", MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.HideBySig),
+                Instruction.Create(OpCodes.Ldarg_0),
+                call,
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Contains(call, NullCheckAnalysis.FindRedundantNullChecks(method));
+        }
+    }
+}
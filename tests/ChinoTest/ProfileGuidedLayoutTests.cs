@@ -0,0 +1,72 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class ProfileGuidedLayoutTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly TypeDef _type;
+
+        public ProfileGuidedLayoutTests()
+        {
+            _type = _module.AddType("Test", _module.CorLibTypes.Object.TypeDefOrRef);
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private MethodDef AddMethod(string name)
+        {
+            return _module.AddMethod(_type, new MethodDefUser(name, MethodSig.CreateStatic(_module.CorLibTypes.Void)));
+        }
+
+        [Fact]
+        public void TestProfileToSectionOrder()
+        {
+            // A shell log with two "profile" dumps, the prefix may follow other output on a line
+            var profile = Path.Combine(_module.Directory, "natsu.profile");
+            File.WriteAllLines(profile, new[]
+            {
+                "$ profile",
+                "natsu-profile: 700 System.Void Chino.Test::Hot()",
+                "natsu-profile: 200 System.Void Chino.Test::Warm()",
+                "$ profile",
+                "[kernel] natsu-profile: 100 System.Void Chino.Test::Warm()",
+                "natsu-profile: 1 System.Void Chino.Test::Rare()",
+                "natsu-profile: garbage",
+            });
+
+            ProfileGuidedLayout.Load(profile);
+            var orderFile = Path.Combine(_module.Directory, "Generated", "natsu.order.ld");
+            ProfileGuidedLayout.WriteSectionOrder(orderFile);
+
+            Assert.Equal(".text.natsu.hot.00000", ProfileGuidedLayout.GetHotSection(AddMethod("Hot")));
+            Assert.Equal(".text.natsu.hot.00001", ProfileGuidedLayout.GetHotSection(AddMethod("Warm")));
+            Assert.Null(ProfileGuidedLayout.GetHotSection(AddMethod("Rare")));
+            Assert.False(ProfileGuidedLayout.IsCold(AddMethod("Rare")));
+            Assert.True(ProfileGuidedLayout.IsCold(AddMethod("Never")));
+            Assert.Equal(
+                "/* Generated by NatsuCLR Compiler, hot methods in profile order */" + Environment.NewLine +
+                "*(.text.natsu.hot.00000)" + Environment.NewLine +
+                "*(.text.natsu.hot.00001)" + Environment.NewLine,
+                File.ReadAllText(orderFile));
+        }
+
+        [Fact]
+        public void TestNoProfile()
+        {
+            ProfileGuidedLayout.Load(Path.Combine(Path.GetTempPath(), Path.GetRandomFileName()));
+
+            Assert.Null(ProfileGuidedLayout.GetHotSection(AddMethod("Hot")));
+            Assert.False(ProfileGuidedLayout.IsCold(AddMethod("Never")));
+        }
+    }
+}
@@ -0,0 +1,92 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    [Collection("Compiler")]
+    public class ReachabilityAnalysisTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private MethodDef AddConstructor(TypeDef type)
+        {
+            return _module.AddMethod(type, new MethodDefUser(".ctor", MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.HideBySig | MethodAttributes.SpecialName | MethodAttributes.RTSpecialName),
+                Instruction.Create(OpCodes.Ret));
+        }
+
+        private MethodDef AddRun(TypeDef type)
+        {
+            return _module.AddMethod(type, new MethodDefUser("Run", MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Virtual | MethodAttributes.HideBySig),
+                Instruction.Create(OpCodes.Ret));
+        }
+
+        [Fact]
+        public void TestUninstantiatedOverridesAreShaken()
+        {
+            var baseType = _module.AddType("Base", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Abstract);
+            var baseRun = _module.AddMethod(baseType, new MethodDefUser("Run", MethodSig.CreateInstance(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Virtual | MethodAttributes.HideBySig | MethodAttributes.NewSlot | MethodAttributes.Abstract));
+
+            var used = _module.AddType("Used", baseType);
+            var usedCtor = AddConstructor(used);
+            var usedRun = AddRun(used);
+            var unused = _module.AddType("Unused", baseType);
+            var unusedCtor = AddConstructor(unused);
+            var unusedRun = AddRun(unused);
+
+            var program = _module.AddType("Program", _module.CorLibTypes.Object.TypeDefOrRef);
+            var dead = _module.AddMethod(program, new MethodDefUser("Dead", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Ret));
+            var main = _module.AddMethod(program, new MethodDefUser("Main", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Newobj, usedCtor),
+                Instruction.Create(OpCodes.Callvirt, baseRun),
+                Instruction.Create(OpCodes.Ret));
+            _module.Module.EntryPoint = main;
+
+            File.WriteAllText(Path.Combine(_module.Directory, "main.cpp"), "int main() { return 0; }");
+            ClassHierarchy.AddModule(_module.Module);
+            ReachabilityAnalysis.Analyze(new[] { _module.Module }, _module.Directory);
+
+            Assert.True(ReachabilityAnalysis.IsReachable(main));
+            Assert.True(ReachabilityAnalysis.IsReachable(usedCtor));
+            Assert.True(ReachabilityAnalysis.IsReachable(usedRun));
+            Assert.False(ReachabilityAnalysis.IsReachable(unusedCtor));
+            Assert.False(ReachabilityAnalysis.IsReachable(unusedRun));
+            Assert.False(ReachabilityAnalysis.IsReachable(dead));
+        }
+
+        [Fact]
+        public void TestNativeReferenceIsRoot()
+        {
+            var program = _module.AddType("Program", _module.CorLibTypes.Object.TypeDefOrRef);
+            var callback = _module.AddMethod(program, new MethodDefUser("OnInterrupt", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Ret));
+            var dead = _module.AddMethod(program, new MethodDefUser("Dead", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Ret));
+
+            File.WriteAllText(Path.Combine(_module.Directory, "irq.cpp"),
+                $"void irq() {{ {TypeUtils.EscapeTypeName(program.FullName)}::{TypeUtils.EscapeMethodName(callback, hasParamType: false)}(); }}");
+            ReachabilityAnalysis.Analyze(new[] { _module.Module }, _module.Directory);
+
+            Assert.True(ReachabilityAnalysis.IsReachable(callback));
+            Assert.False(ReachabilityAnalysis.IsReachable(dead));
+        }
+    }
+}
@@ -0,0 +1,72 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class RootPoolTests
+    {
+        private readonly ModuleDef _module = new ModuleDefUser("Test");
+        private readonly RootPool _roots = new RootPool();
+        private readonly EvaluationStack _stack;
+
+        public RootPoolTests()
+        {
+            _stack = new EvaluationStack(new StringWriter(), 0, 0, _roots);
+        }
+
+        private StackEntry PushRooted(string expression)
+        {
+            _stack.Push(_module.CorLibTypes.Object, expression);
+            _stack.Root();
+            return _stack.Peek();
+        }
+
+        [Fact]
+        public void TestConsumedRootIsReused()
+        {
+            var first = PushRooted("f()");
+            _stack.Pop();
+            var second = PushRooted("g()");
+
+            Assert.Equal(first.Expression, second.Expression);
+            Assert.Single(_roots.Roots);
+        }
+
+        [Fact]
+        public void TestLiveRootIsNotReused()
+        {
+            var first = PushRooted("f()");
+            var second = PushRooted("g()");
+
+            Assert.NotEqual(first.Expression, second.Expression);
+            Assert.Equal(2, _roots.Roots.Count);
+        }
+
+        [Fact]
+        public void TestRootReadByNewValueIsNotReused()
+        {
+            var first = PushRooted("f()");
+            _stack.Pop();
+            var second = PushRooted($"g({first.Expression})");
+
+            Assert.NotEqual(first.Expression, second.Expression);
+        }
+
+        [Fact]
+        public void TestComputedCopyKeepsRootAlive()
+        {
+            var first = PushRooted("f()");
+            _stack.Pop();
+            _stack.Push(_module.CorLibTypes.Object, $"g({first.Expression})");
+            _stack.Compute();
+            var second = PushRooted("h()");
+
+            Assert.NotEqual(first.Expression, second.Expression);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class StaticEvaluatorTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+        private readonly TypeDef _type;
+
+        public StaticEvaluatorTests()
+        {
+            _type = _module.AddType("Tables", _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Abstract | TypeAttributes.Sealed);
+        }
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private FieldDef AddField(TypeDef type, string name, TypeSig fieldType)
+        {
+            var field = new FieldDefUser(name, new FieldSig(fieldType), FieldAttributes.Public | FieldAttributes.Static);
+            type.Fields.Add(field);
+            return field;
+        }
+
+        private MethodDef AddCctor(params Instruction[] instructions)
+        {
+            return _module.AddMethod(_type, new MethodDefUser(".cctor", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Private | MethodAttributes.Static | MethodAttributes.HideBySig | MethodAttributes.SpecialName | MethodAttributes.RTSpecialName),
+                instructions);
+        }
+
+        [Fact]
+        public void TestScalarsAreNarrowedToFieldType()
+        {
+            var small = AddField(_type, "Small", _module.CorLibTypes.Byte);
+            var name = AddField(_type, "Name", _module.CorLibTypes.String);
+            var fields = StaticEvaluator.TryEvaluate(AddCctor(
+                Instruction.Create(OpCodes.Ldc_I4, 300),
+                Instruction.Create(OpCodes.Stsfld, small),
+                Instruction.Create(OpCodes.Ldstr, "natsu"),
+                Instruction.Create(OpCodes.Stsfld, name),
+                Instruction.Create(OpCodes.Ret)));
+
+            Assert.NotNull(fields);
+            Assert.Equal((byte)44, fields[small]);
+            Assert.Equal("natsu", fields[name]);
+        }
+
+        [Fact]
+        public void TestPrimitiveArrayIsFrozen()
+        {
+            var table = AddField(_type, "Table", new SZArraySig(_module.CorLibTypes.Int32));
+            var fields = StaticEvaluator.TryEvaluate(AddCctor(
+                Instruction.Create(OpCodes.Ldc_I4_3),
+                Instruction.Create(OpCodes.Newarr, _module.CorLibTypes.Int32.TypeDefOrRef),
+                Instruction.Create(OpCodes.Dup),
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                Instruction.Create(OpCodes.Ldc_I4, 7),
+                Instruction.Create(OpCodes.Stelem_I4),
+                Instruction.Create(OpCodes.Stsfld, table),
+                Instruction.Create(OpCodes.Ret)));
+
+            Assert.NotNull(fields);
+            var array = Assert.IsType<FrozenArray>(fields[table]);
+            Assert.Equal(new object[] { 0, 7, 0 }, array.Elements);
+        }
+
+        [Fact]
+        public void TestCallIsNotEvaluated()
+        {
+            var value = AddField(_type, "Value", _module.CorLibTypes.Int32);
+            var compute = _module.AddMethod(_type, new MethodDefUser("Compute", MethodSig.CreateStatic(_module.CorLibTypes.Int32),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Null(StaticEvaluator.TryEvaluate(AddCctor(
+                Instruction.Create(OpCodes.Call, compute),
+                Instruction.Create(OpCodes.Stsfld, value),
+                Instruction.Create(OpCodes.Ret))));
+        }
+
+        [Fact]
+        public void TestStoreToOtherTypeIsNotEvaluated()
+        {
+            var other = _module.AddType("Other", _module.CorLibTypes.Object.TypeDefOrRef);
+            var value = AddField(other, "Value", _module.CorLibTypes.Int32);
+
+            Assert.Null(StaticEvaluator.TryEvaluate(AddCctor(
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                Instruction.Create(OpCodes.Stsfld, value),
+                Instruction.Create(OpCodes.Ret))));
+        }
+    }
+}
@@ -0,0 +1,97 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+using Natsu.Compiler;
+using Xunit;
+
+namespace ChinoTest
+{
+    public class StaticInitOrderTests : IDisposable
+    {
+        private readonly TestModule _module = new TestModule();
+
+        public void Dispose()
+        {
+            _module.Dispose();
+        }
+
+        private (TypeDef type, FieldDef field) AddStaticType(string name)
+        {
+            var type = _module.AddType(name, _module.CorLibTypes.Object.TypeDefOrRef, TypeAttributes.Public | TypeAttributes.Abstract | TypeAttributes.Sealed);
+            var field = new FieldDefUser("Value", new FieldSig(_module.CorLibTypes.Int32), FieldAttributes.Public | FieldAttributes.Static);
+            type.Fields.Add(field);
+            return (type, field);
+        }
+
+        private MethodDef AddCctor(TypeDef type, params Instruction[] instructions)
+        {
+            return _module.AddMethod(type, new MethodDefUser(".cctor", MethodSig.CreateStatic(_module.CorLibTypes.Void),
+                MethodAttributes.Private | MethodAttributes.Static | MethodAttributes.HideBySig | MethodAttributes.SpecialName | MethodAttributes.RTSpecialName),
+                instructions);
+        }
+
+        [Fact]
+        public void TestStaticReadIsInitializedFirst()
+        {
+            var (first, firstValue) = AddStaticType("First");
+            var (second, secondValue) = AddStaticType("Second");
+            AddCctor(first,
+                Instruction.Create(OpCodes.Ldsfld, secondValue),
+                Instruction.Create(OpCodes.Stsfld, firstValue),
+                Instruction.Create(OpCodes.Ret));
+            AddCctor(second,
+                Instruction.Create(OpCodes.Ldc_I4_1),
+                Instruction.Create(OpCodes.Stsfld, secondValue),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Equal(new[] { second, first }, Generator.GetStaticInitOrder(new[] { first, second }, _module.Module));
+        }
+
+        [Fact]
+        public void TestCalleeTypeIsInitializedFirst()
+        {
+            var (first, firstValue) = AddStaticType("First");
+            var (second, secondValue) = AddStaticType("Second");
+            var get = _module.AddMethod(second, new MethodDefUser("Get", MethodSig.CreateStatic(_module.CorLibTypes.Int32),
+                MethodAttributes.Public | MethodAttributes.Static),
+                Instruction.Create(OpCodes.Ldsfld, secondValue),
+                Instruction.Create(OpCodes.Ret));
+            AddCctor(first,
+                Instruction.Create(OpCodes.Call, get),
+                Instruction.Create(OpCodes.Stsfld, firstValue),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Equal(new[] { second, first }, Generator.GetStaticInitOrder(new[] { first, second }, _module.Module));
+        }
+
+        [Fact]
+        public void TestCycleIsBrokenAtBackEdge()
+        {
+            var (first, firstValue) = AddStaticType("First");
+            var (second, secondValue) = AddStaticType("Second");
+            AddCctor(first,
+                Instruction.Create(OpCodes.Ldsfld, secondValue),
+                Instruction.Create(OpCodes.Stsfld, firstValue),
+                Instruction.Create(OpCodes.Ret));
+            AddCctor(second,
+                Instruction.Create(OpCodes.Ldsfld, firstValue),
+                Instruction.Create(OpCodes.Stsfld, secondValue),
+                Instruction.Create(OpCodes.Ret));
+
+            Assert.Equal(new[] { second, first }, Generator.GetStaticInitOrder(new[] { first, second }, _module.Module));
+        }
+
+        [Fact]
+        public void TestTypesWithoutStaticsAreSkipped()
+        {
+            var (first, _) = AddStaticType("First");
+            var plain = _module.AddType("Plain", _module.CorLibTypes.Object.TypeDefOrRef);
+            var generic = AddStaticType("Generic`1").type;
+            generic.GenericParameters.Add(new GenericParamUser(0, GenericParamAttributes.NonVariant, "T"));
+
+            Assert.Equal(new[] { first }, Generator.GetStaticInitOrder(new[] { plain, first, generic }, _module.Module));
+        }
+    }
+}
@@ -0,0 +1,65 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using dnlib.DotNet;
+using dnlib.DotNet.Emit;
+
+namespace ChinoTest
+{
+    // A module for compiler tests to build types and IL in, with a scratch directory deleted on dispose
+    internal sealed class TestModule : IDisposable
+    {
+        private string _directory;
+
+        public ModuleDef Module { get; } = new ModuleDefUser("Test");
+
+        public ICorLibTypes CorLibTypes => Module.CorLibTypes;
+
+        public string Directory
+        {
+            get
+            {
+                if (_directory == null)
+                {
+                    _directory = Path.Combine(Path.GetTempPath(), Path.GetRandomFileName());
+                    System.IO.Directory.CreateDirectory(_directory);
+                }
+
+                return _directory;
+            }
+        }
+
+        public TestModule()
+        {
+            new AssemblyDefUser("Test").Modules.Add(Module);
+        }
+
+        public TypeDef AddType(string name, ITypeDefOrRef baseType, TypeAttributes attributes = TypeAttributes.Public)
+        {
+            var type = new TypeDefUser("Chino", name, baseType) { Attributes = attributes };
+            Module.Types.Add(type);
+            return type;
+        }
+
+        // Methods given no instructions get no body, like abstract methods
+        public MethodDef AddMethod(TypeDef type, MethodDef method, params Instruction[] instructions)
+        {
+            type.Methods.Add(method);
+            if (instructions.Length != 0)
+            {
+                method.Body = new CilBody();
+                foreach (var inst in instructions)
+                    method.Body.Instructions.Add(inst);
+            }
+
+            return method;
+        }
+
+        public void Dispose()
+        {
+            if (_directory != null)
+                System.IO.Directory.Delete(_directory, true);
+        }
+    }
+}